@@ -0,0 +1,170 @@
+#include <string.h>
+
+#include "atlas_wheel.h"
+
+static bool
+skyline_fit(const AtlasPage *page, uint32 size, uint32 index, uint32 width, uint32 height, uint32 *y);
+
+static bool
+skyline_place(AtlasPage *page, uint32 size, uint32 width, uint32 height, uint32 *x, uint32 *y);
+
+static void
+skyline_reset(AtlasPage *page, uint32 size);
+
+TextureAtlas *
+atlas_create(AppMemory *mem, uint32 page_size, uint32 page_count) {
+    assert(page_count <= ATLAS_MAX_PAGES);
+    TextureAtlas *atlas = (TextureAtlas *)get_memory(mem, sizeof(TextureAtlas));
+    memset(atlas, 0, sizeof(*atlas));
+    atlas->page_count = page_count;
+    atlas->page_size = page_size;
+    for (uint32 i = 0; i < page_count; i++) {
+        AtlasPage *page = &atlas->pages[i];
+        page->texture.pixels = (uint32 *)get_memory(mem, (uint64)page_size * page_size * sizeof(uint32));
+        page->texture.width = page_size;
+        page->texture.height = page_size;
+        // Every node is at least one pixel wide.
+        page->skyline = (SkylineNode *)get_memory(mem, page_size * sizeof(SkylineNode));
+        memset(page->texture.pixels, 0, (uint64)page_size * page_size * sizeof(uint32));
+        skyline_reset(page, page_size);
+    }
+    return atlas;
+}
+
+AtlasRegion
+atlas_allocate(TextureAtlas *atlas, uint32 width, uint32 height) {
+    AtlasRegion region = {};
+    if (!width || !height)
+        return region;
+    uint32 x = 0, y = 0;
+    uint32 page = atlas->page_count;
+    // Pages in use first, so that empty ones stay free for large textures.
+    for (uint32 pass = 0; pass < 2 && page == atlas->page_count; pass++) {
+        for (uint32 i = 0; i < atlas->page_count; i++) {
+            AtlasPage *p = &atlas->pages[i];
+            if ((p->region_count == 0) != (pass == 1))
+                continue;
+            if (skyline_place(p, atlas->page_size, width, height, &x, &y)) {
+                page = i;
+                break;
+            }
+        }
+    }
+    if (page == atlas->page_count)
+        return region;
+    AtlasPage *p = &atlas->pages[page];
+    p->region_count++;
+    p->used_area += (uint64)width * height;
+    region.page = page;
+    region.generation = p->generation;
+    region.x = x;
+    region.y = y;
+    region.width = width;
+    region.height = height;
+    return region;
+}
+
+AtlasRegion
+atlas_insert(TextureAtlas *atlas, Texture texture) {
+    assert(!texture.mips);
+    AtlasRegion region = atlas_allocate(atlas, texture.width, texture.height);
+    if (!region.width)
+        return region;
+    Texture page = atlas_page_texture(atlas, region);
+    for (uint32 row = 0; row < region.height; row++) {
+        memcpy(page.pixels + region.x + (uint64)(region.y + row) * atlas->page_size,
+               texture.pixels + (uint64)row * texture.width, texture.width * sizeof(uint32));
+    }
+    return region;
+}
+
+void
+atlas_evict_page(TextureAtlas *atlas, uint32 page) {
+    AtlasPage *p = &atlas->pages[page];
+    memset(p->texture.pixels, 0, (uint64)atlas->page_size * atlas->page_size * sizeof(uint32));
+    skyline_reset(p, atlas->page_size);
+    p->generation++;
+    p->region_count = 0;
+    p->used_area = 0;
+}
+
+// Top of a region of 'width' x 'height' whose left edge is at node 'index',
+// which has to clear every node it spans.
+static bool
+skyline_fit(const AtlasPage *page, uint32 size, uint32 index, uint32 width, uint32 height, uint32 *y) {
+    const SkylineNode *node = &page->skyline[index];
+    if (node->x + width > size)
+        return false;
+    uint32 top = 0;
+    int64 width_left = width;
+    for (uint32 i = index; width_left > 0; i++) {
+        top = max(top, page->skyline[i].y);
+        if (top + height > size)
+            return false;
+        width_left -= page->skyline[i].width;
+    }
+    *y = top;
+    return true;
+}
+
+// Bottom-left placement, with the page growing down from row 0: the position
+// where the bottom edge of the region ends up nearest the top, ties going to
+// the narrowest node, so that gaps get filled.
+static bool
+skyline_place(AtlasPage *page, uint32 size, uint32 width, uint32 height, uint32 *x, uint32 *y) {
+    uint32 best = page->node_count;
+    uint32 best_bottom = 0xFFFFFFFF;
+    uint32 best_width = 0xFFFFFFFF;
+    uint32 best_y = 0;
+    for (uint32 i = 0; i < page->node_count; i++) {
+        uint32 top;
+        if (!skyline_fit(page, size, i, width, height, &top))
+            continue;
+        uint32 bottom = top + height;
+        if (bottom < best_bottom || (bottom == best_bottom && page->skyline[i].width < best_width)) {
+            best = i;
+            best_bottom = bottom;
+            best_width = page->skyline[i].width;
+            best_y = top;
+        }
+    }
+    if (best == page->node_count)
+        return false;
+
+    // The new node replaces whatever it covers.
+    SkylineNode *nodes = page->skyline;
+    uint32 left = nodes[best].x;
+    uint32 right = left + width;
+    uint32 end = best;
+    while (end < page->node_count && nodes[end].x + nodes[end].width <= right) {
+        end++;
+    }
+    // A node reaching past the new one keeps its right part.
+    if (end < page->node_count && nodes[end].x < right) {
+        nodes[end].width -= right - nodes[end].x;
+        nodes[end].x = right;
+    }
+    memmove(nodes + best + 1, nodes + end, (page->node_count - end) * sizeof(SkylineNode));
+    page->node_count = page->node_count + 1 - (end - best);
+    nodes[best] = {left, best_y + height, width};
+
+    // Merge neighbours at the same height.
+    uint32 count = 1;
+    for (uint32 i = 1; i < page->node_count; i++) {
+        if (nodes[i].y == nodes[count - 1].y)
+            nodes[count - 1].width += nodes[i].width;
+        else
+            nodes[count++] = nodes[i];
+    }
+    page->node_count = count;
+
+    *x = left;
+    *y = best_y;
+    return true;
+}
+
+static void
+skyline_reset(AtlasPage *page, uint32 size) {
+    page->skyline[0] = {0, 0, size};
+    page->node_count = 1;
+}
@@ -0,0 +1,103 @@
+#ifndef ATLAS_WHEEL_H
+
+#include "render_wheel.h"
+#include "memory_wheel.h"
+
+#define ATLAS_MAX_PAGES 8
+
+/* Texture atlas.
+ *
+ * Small textures are copied into a few large square pages, so that draws of
+ * different images read from the same pixels and can share a batch. Every
+ * page packs its regions along a skyline: the top edge of what has been
+ * placed so far, as segments from left to right. A new region goes where its
+ * bottom edge ends up nearest the top of the page, which keeps the pages
+ * dense without ever moving what is already there.
+ *
+ * Regions are packed tight. Blits and sprites clamp to their source
+ * rectangle, but a mesh that samples outside its region or a page with mip
+ * levels reads from the neighbours.
+ *
+ * Pages are only freed as a whole. Evicting one bumps its generation, which
+ * tells the regions handed out before that they are gone.
+ */
+struct SkylineNode {
+    uint32 x, y;
+    uint32 width;
+};
+
+struct AtlasPage {
+    Texture texture;
+    SkylineNode *skyline; // Sorted by x, covers the whole width
+    uint32 node_count;
+    uint32 generation;
+    uint32 region_count;
+    uint64 used_area;
+};
+
+// A region without width did not fit.
+struct AtlasRegion {
+    uint32 page;
+    uint32 generation;
+    uint32 x, y;
+    uint32 width, height;
+};
+
+struct TextureAtlas {
+    AtlasPage pages[ATLAS_MAX_PAGES];
+    uint32 page_count;
+    uint32 page_size;
+};
+
+// 'page_count' pages of 'page_size' squared pixels, all allocated up front.
+TextureAtlas *
+atlas_create(AppMemory *mem, uint32 page_size, uint32 page_count);
+
+// Place a region of 'width' x 'height' in the first page it fits in, trying
+// empty pages last. Its pixels are clear, for the caller to draw into.
+AtlasRegion
+atlas_allocate(TextureAtlas *atlas, uint32 width, uint32 height);
+
+// Copy 'texture' into a region from atlas_allocate. Textures with a mip chain
+// have no pixels to copy.
+AtlasRegion
+atlas_insert(TextureAtlas *atlas, Texture texture);
+
+// Drop every region of 'page' and clear its pixels.
+void
+atlas_evict_page(TextureAtlas *atlas, uint32 page);
+
+inline bool
+atlas_region_valid(const TextureAtlas *atlas, const AtlasRegion &region) {
+    return region.width && atlas->pages[region.page].generation == region.generation;
+}
+
+inline Texture
+atlas_page_texture(const TextureAtlas *atlas, const AtlasRegion &region) {
+    return atlas->pages[region.page].texture;
+}
+
+// Blit of the region out of its page texture.
+inline Blit
+atlas_blit(const AtlasRegion &region, BlitMode mode) {
+    Blit blit = {};
+    blit.src_x = region.x;
+    blit.src_y = region.y;
+    blit.width = region.width;
+    blit.height = region.height;
+    blit.mode = mode;
+    blit.tint = 0xFFFFFFFF;
+    return blit;
+}
+
+// Texture coordinates count in the shorter side of a texture, so 'uv' of
+// the inserted texture maps into its page by one offset and one scale.
+inline v2
+atlas_region_uv(const TextureAtlas *atlas, const AtlasRegion &region, v2 uv) {
+    real32 size = (real32)atlas->page_size;
+    real32 scale = (real32)min(region.width, region.height) / size;
+    return {region.x / size + uv.x * scale, region.y / size + uv.y * scale};
+}
+
+#define ATLAS_WHEEL_H
+#endif
@@ -0,0 +1,154 @@
+#include <stdlib.h>
+#include <math.h>
+#include "batch_wheel.h"
+
+static int
+piece_compare(const void *a, const void *b);
+
+static bool
+same_batch(const BatchPiece *a, const BatchPiece *b);
+
+BatchBuilder *
+batch_builder_create(AppMemory *mem, uint32 max_pieces, real32 cell_size) {
+    BatchBuilder *builder = (BatchBuilder *)get_memory(mem, sizeof(BatchBuilder));
+    memset(builder, 0, sizeof(*builder));
+    builder->pieces = (BatchPiece *)get_memory(mem, max_pieces * sizeof(BatchPiece));
+    builder->max_pieces = max_pieces;
+    builder->cell_size = cell_size;
+    return builder;
+}
+
+bool
+batch_add(BatchBuilder *builder, Mesh mesh, Transform t, Texture *texture, v4 *color) {
+    if (builder->piece_count == builder->max_pieces)
+        return false;
+    BatchPiece *piece = &builder->pieces[builder->piece_count++];
+    piece->mesh = mesh;
+    piece->t = t;
+    // A solid color wins over the texture, see draw_mesh.
+    piece->texture = color ? 0 : texture;
+    piece->color = color ? *color : v4{};
+    piece->has_color = color != 0;
+    piece->cell_x = 0;
+    piece->cell_y = 0;
+    piece->order = builder->piece_count - 1;
+    if (builder->cell_size > 0.0f) {
+        BoundingBox b = transform_bounds(mesh.bounds, t);
+        v2 center = (b.min + b.max) * 0.5f;
+        piece->cell_x = (int32)floorf(center.x / builder->cell_size);
+        piece->cell_y = (int32)floorf(center.y / builder->cell_size);
+    }
+    return true;
+}
+
+StaticBatches
+batch_build(BatchBuilder *builder, AppMemory *mem) {
+    StaticBatches result = {};
+    BatchPiece *pieces = builder->pieces;
+    uint32 count = builder->piece_count;
+    builder->piece_count = 0;
+    if (!count)
+        return result;
+    qsort(pieces, count, sizeof(BatchPiece), piece_compare);
+
+    uint32 total_vertices = 0;
+    uint32 total_indices = 0;
+    for (uint32 i = 0; i < count; i++) {
+        total_vertices += pieces[i].mesh.vertex_count;
+        total_indices += pieces[i].mesh.index_count;
+        if (!i || !same_batch(&pieces[i - 1], &pieces[i]))
+            result.count++;
+    }
+    result.batches = (MeshBatch *)get_memory(mem, result.count * sizeof(MeshBatch));
+    // All batches share one vertex and one index buffer, like meshes created
+    // with create_polygon. Pieces may come with different layouts, so the
+    // batches get all streams.
+    VertexStreams vertices = create_vertexbuffer(mem, total_vertices, VERTEX_LAYOUT_FULL).streams;
+    uint32 *indices = (uint32 *)get_memory(mem, total_indices * sizeof(uint32));
+    result.vertices = vertices;
+    result.indices = indices;
+    result.vertex_count = total_vertices;
+    result.index_count = total_indices;
+
+    uint32 vertex_count = 0;
+    uint32 index_count = 0;
+    MeshBatch *batch = result.batches - 1;
+    for (uint32 i = 0; i < count; i++) {
+        const BatchPiece *piece = &pieces[i];
+        const Mesh *mesh = &piece->mesh;
+        if (!i || !same_batch(&pieces[i - 1], piece)) {
+            batch++;
+            memset(batch, 0, sizeof(*batch));
+            batch->texture = piece->texture;
+            batch->mesh.vertices = vertices;
+            batch->mesh.i = indices + index_count;
+            batch->mesh.first_vertex = vertex_count;
+            batch->mesh.bounds = transform_bounds(mesh->bounds, piece->t);
+        }
+        const VertexStreams &v = mesh->vertices;
+        uint32 color = piece->has_color ? pack_vertex_color(piece->color) : 0;
+        for (uint32 j = 0; j < mesh->vertex_count; j++) {
+            uint32 src = mesh->first_vertex + j;
+            uint32 dst = vertex_count + j;
+            vertices.positions[dst] = transform(v.positions[src], piece->t);
+            if (piece->has_color)
+                vertices.colors[dst] = color;
+            else
+                vertices.colors[dst] = v.colors ? v.colors[src] : 0xFFFFFFFF;
+            vertices.tex_coords[dst] = v.tex_coords ? v.tex_coords[src] : PackedTexCoord{0, 0};
+        }
+        for (uint32 j = 0; j < mesh->index_count; j++) {
+            indices[index_count + j] = mesh->i[j] - mesh->first_vertex + vertex_count;
+        }
+        BoundingBox b = transform_bounds(mesh->bounds, piece->t);
+        batch->mesh.bounds.min.x = min(batch->mesh.bounds.min.x, b.min.x);
+        batch->mesh.bounds.min.y = min(batch->mesh.bounds.min.y, b.min.y);
+        batch->mesh.bounds.max.x = max(batch->mesh.bounds.max.x, b.max.x);
+        batch->mesh.bounds.max.y = max(batch->mesh.bounds.max.y, b.max.y);
+        batch->mesh.vertex_count += mesh->vertex_count;
+        batch->mesh.index_count += mesh->index_count;
+        vertex_count += mesh->vertex_count;
+        index_count += mesh->index_count;
+    }
+    return result;
+}
+
+void
+batch_free(StaticBatches *batches, AppMemory *mem) {
+    if (!batches->count)
+        return;
+    free_memory(mem, batches->indices, batches->index_count * sizeof(uint32));
+    free_memory(mem, batches->vertices.tex_coords, batches->vertex_count * sizeof(PackedTexCoord));
+    free_memory(mem, batches->vertices.colors, batches->vertex_count * sizeof(uint32));
+    free_memory(mem, batches->vertices.positions, batches->vertex_count * sizeof(v2));
+    free_memory(mem, batches->batches, batches->count * sizeof(MeshBatch));
+    memset(batches, 0, sizeof(*batches));
+}
+
+void
+render_push_batches(RenderCommands *rc, uint64 key, const Camera &camera, StaticBatches batches) {
+    Transform identity = {{0, 0}, {1, 1}, 0};
+    for (uint32 i = 0; i < batches.count; i++) {
+        MeshBatch *batch = &batches.batches[i];
+        render_push_mesh(rc, key, camera, batch->mesh, identity, batch->texture, 0);
+    }
+}
+
+// By texture, then by cell, so that every batch is one run of pieces.
+static int
+piece_compare(const void *a, const void *b) {
+    const BatchPiece *pa = (const BatchPiece *)a;
+    const BatchPiece *pb = (const BatchPiece *)b;
+    if (pa->texture != pb->texture)
+        return (uint64)pa->texture < (uint64)pb->texture ? -1 : 1;
+    if (pa->cell_y != pb->cell_y)
+        return pa->cell_y < pb->cell_y ? -1 : 1;
+    if (pa->cell_x != pb->cell_x)
+        return pa->cell_x < pb->cell_x ? -1 : 1;
+    return pa->order < pb->order ? -1 : (pa->order > pb->order);
+}
+
+static bool
+same_batch(const BatchPiece *a, const BatchPiece *b) {
+    return a->texture == b->texture && a->cell_x == b->cell_x && a->cell_y == b->cell_y;
+}
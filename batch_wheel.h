@@ -0,0 +1,73 @@
+#ifndef BATCH_WHEEL_H
+
+#include "render_wheel.h"
+#include "command_wheel.h"
+#include "memory_wheel.h"
+
+/* Static geometry batches.
+ *
+ * Meshes that never move are added to a builder once, together with their
+ * transform and material. Building transforms their vertices to world space
+ * and merges all pieces with the same texture into one mesh. A batch is culled
+ * with a single box and drawn with a single call and the identity transform.
+ *
+ * Solid colors are baked into the vertex colors, so only the texture tells
+ * pieces apart. With a cell size, pieces are also split up by the grid cell
+ * their center falls into, so that culling still skips most of a large level.
+ * Within a batch pieces keep the order they were added in, but overlapping
+ * pieces from different batches may change order.
+ */
+struct BatchPiece {
+    Mesh mesh;
+    Transform t;
+    Texture *texture; // 0 for vertex or solid colors
+    v4 color;
+    bool has_color;
+    int32 cell_x, cell_y;
+    uint32 order; // Keeps the sort stable
+};
+
+struct MeshBatch {
+    Mesh mesh; // World space
+    Texture *texture;
+};
+
+struct BatchBuilder {
+    BatchPiece *pieces;
+    uint32 piece_count;
+    uint32 max_pieces;
+    real32 cell_size; // 0 to merge pieces regardless of position
+};
+
+// The batches share one set of streams, kept here to be freed.
+struct StaticBatches {
+    MeshBatch *batches;
+    uint32 count;
+    VertexStreams vertices;
+    uint32 *indices;
+    uint32 vertex_count, index_count;
+};
+
+BatchBuilder *
+batch_builder_create(AppMemory *mem, uint32 max_pieces, real32 cell_size);
+
+// Add a piece of static geometry. 'color' overrides the vertex colors and
+// texture like it does for draw_mesh. Returns false if the builder is full.
+bool
+batch_add(BatchBuilder *builder, Mesh mesh, Transform t, Texture *texture, v4 *color);
+
+// Bake all pieces into batches allocated from 'mem' and empty the builder.
+// The pieces' meshes are copied and can go away afterwards.
+StaticBatches
+batch_build(BatchBuilder *builder, AppMemory *mem);
+
+// Hand the memory of 'batches' back to 'mem', which has to be the one they
+// were built from.
+void
+batch_free(StaticBatches *batches, AppMemory *mem);
+
+void
+render_push_batches(RenderCommands *rc, uint64 key, const Camera &camera, StaticBatches batches);
+
+#define BATCH_WHEEL_H
+#endif
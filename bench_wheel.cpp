@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "bench_wheel.h"
+#include "files_wheel.h"
+#include "hud_wheel.h"
+#include "tile_wheel.h"
+
+#define BENCH_STORM_TRIANGLES 4000
+#define BENCH_SLIVER_COUNT 2000
+#define BENCH_TEXTURED_QUADS 200
+#define BENCH_ALPHA_LAYERS 32
+#define BENCH_LINE_COUNT 1500
+
+struct BenchLine {
+    v2 a, b;
+    uint32 thickness;
+    v4 color;
+};
+
+struct BenchScenes {
+    Camera camera;
+    MemoryArena scratch;
+    Vertexbuffer vb;
+    Indexbuffer ib;
+    Mesh storm;
+    Mesh slivers;
+    v4 sliver_color;
+    Mesh textured;
+    Texture texture;
+    Mesh alpha_quads[BENCH_ALPHA_LAYERS];
+    v4 alpha_colors[BENCH_ALPHA_LAYERS];
+    BenchLine lines[BENCH_LINE_COUNT];
+    char *text;
+    Font font;
+};
+
+static uint32
+bench_random(uint32 *state);
+
+static real32
+bench_uniform(uint32 *state, real32 lo, real32 hi);
+
+static v4
+bench_color(uint32 *state, real32 alpha);
+
+static Mesh
+build_quads(BenchScenes *s, uint32 *state, uint32 count, real32 min_size, real32 max_size, real64 *pixels);
+
+static void
+build_scenes(BenchScenes *s, AppMemory *mem, Font font, uint32 width, uint32 height, BenchResult *results);
+
+static void
+draw_case(BenchScenes *s, BenchCase c, Framebuffer fb);
+
+static uint32
+compare_golden(Framebuffer fb, Texture golden);
+
+uint32
+bench_run(AppMemory *mem, JobSystem *jobs, Font font, uint32 width, uint32 height, uint32 frames, const char *golden_dir, bool record, BenchResult *results) {
+    static const char *names[BENCH_CASE_COUNT] = {"polygon_storm", "slivers", "textured_meshes", "alpha_stack", "thick_lines", "text"};
+    BenchScenes *s = (BenchScenes *)get_memory(mem, sizeof(BenchScenes));
+    memset(s, 0, sizeof(*s));
+    memset(results, 0, BENCH_CASE_COUNT * sizeof(BenchResult));
+    build_scenes(s, mem, font, width, height, results);
+
+    Framebuffer fb = {};
+    fb.width = width;
+    fb.height = height;
+    fb.bytes_per_pixel = 4;
+    fb.clip_x1 = width;
+    fb.clip_y1 = height;
+    fb.antialias = true;
+    fb.data = (uint32 *)get_memory(mem, (uint64)width * height * sizeof(uint32));
+    Texture frame = {};
+    frame.pixels = fb.data;
+    frame.width = width;
+    frame.height = height;
+    // The first direct frame, for the tiled ones to match.
+    Texture direct = frame;
+    direct.pixels = (uint32 *)get_memory(mem, (uint64)width * height * sizeof(uint32));
+    TileRenderer *tiles = tile_renderer_create(mem, megabytes(4), jobs);
+    uint32 max_mismatches = width * height / BENCH_MISMATCH_RATIO;
+
+    uint32 failed = 0;
+    for (uint32 c = 0; c < BENCH_CASE_COUNT; c++) {
+        BenchResult *r = &results[c];
+        r->name = names[c];
+        r->seconds = 1e30;
+        for (uint32 i = 0; i < frames; i++) {
+            // Backgrounds are opaque, so frames survive the trip through
+            // a BMP unchanged.
+            clear_framebuffer(fb, {0.1f, 0.1f, 0.12f, 1});
+            real64 begin = hud_clock();
+            draw_case(s, (BenchCase)c, fb);
+            r->seconds = min(r->seconds, hud_clock() - begin);
+            if (i > 0)
+                continue;
+            memcpy(direct.pixels, fb.data, (uint64)width * height * sizeof(uint32));
+            char path[512];
+            snprintf(path, sizeof(path), "%s/%s.bmp", golden_dir, r->name);
+            if (record) {
+                r->passed = save_bmp_file(path, frame);
+                continue;
+            }
+            // load_bmp_file gives up on missing files.
+            FILE *f = fopen(path, "rb");
+            r->compared = f != 0;
+            if (!f)
+                continue;
+            fclose(f);
+            Texture golden = load_bmp_file(path, mem, 0);
+            r->mismatches = compare_golden(fb, golden);
+            r->passed = r->mismatches <= max_mismatches;
+            free_memory(mem, golden.pixels, (uint64)golden.width * golden.height * sizeof(uint32));
+        }
+
+        r->tiled_seconds = 1e30;
+        Framebuffer tiled = fb;
+        tiled.tiles = tiles;
+        for (uint32 i = 0; i < frames; i++) {
+            clear_framebuffer(fb, {0.1f, 0.1f, 0.12f, 1});
+            real64 begin = hud_clock();
+            tile_renderer_begin(tiles, tiled);
+            draw_case(s, (BenchCase)c, tiled);
+            tile_renderer_end(tiles);
+            r->tiled_seconds = min(r->tiled_seconds, hud_clock() - begin);
+            if (i == 0)
+                r->tiled_mismatches = compare_golden(fb, direct);
+        }
+        r->passed = r->passed && r->tiled_mismatches <= max_mismatches;
+        failed += !r->passed;
+    }
+    return failed;
+}
+
+// Xorshift, so that every platform generates the same scenes.
+static uint32
+bench_random(uint32 *state) {
+    uint32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static real32
+bench_uniform(uint32 *state, real32 lo, real32 hi) {
+    return lo + (hi - lo) * (real32)(bench_random(state) >> 8) / (real32)(1 << 24);
+}
+
+static v4
+bench_color(uint32 *state, real32 alpha) {
+    return {bench_uniform(state, 0.2f, 1), bench_uniform(state, 0.2f, 1), bench_uniform(state, 0.2f, 1), alpha};
+}
+
+// Rotated squares with the whole texture on each, as one mesh.
+static Mesh
+build_quads(BenchScenes *s, uint32 *state, uint32 count, real32 min_size, real32 max_size, real64 *pixels) {
+    Vertex *vertices = (Vertex *)arena_push(&s->scratch, 4 * count * sizeof(Vertex));
+    uint32 *indices = (uint32 *)arena_push(&s->scratch, 6 * count * sizeof(uint32));
+    static const v2 corners[4] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+    static const uint32 quad[6] = {0, 1, 2, 0, 2, 3};
+    real32 width = (real32)s->camera.width;
+    real32 height = (real32)s->camera.height;
+    for (uint32 i = 0; i < count; i++) {
+        v2 center = {bench_uniform(state, 0, width), bench_uniform(state, 0, height)};
+        real32 half = bench_uniform(state, min_size, max_size) / 2;
+        real32 angle = bench_uniform(state, 0, 2 * PI);
+        v2 x_axis = {cosf(angle) * half, sinf(angle) * half};
+        v2 y_axis = {-x_axis.y, x_axis.x};
+        for (uint32 j = 0; j < 4; j++) {
+            Vertex *v = &vertices[4 * i + j];
+            v->coord = center + x_axis * corners[j].x + y_axis * corners[j].y;
+            v->color = {1, 1, 1, 1};
+            v->tex_coord = {(corners[j].x + 1) / 2, (corners[j].y + 1) / 2};
+        }
+        for (uint32 j = 0; j < 6; j++) {
+            indices[6 * i + j] = 4 * i + quad[j];
+        }
+        *pixels += 4 * half * half;
+    }
+    Mesh mesh = create_polygon(&s->vb, &s->ib, vertices, 4 * count, indices, 6 * count);
+    arena_reset(&s->scratch);
+    return mesh;
+}
+
+static void
+build_scenes(BenchScenes *s, AppMemory *mem, Font font, uint32 width, uint32 height, BenchResult *results) {
+    uint32 state = 0x9E3779B9;
+    real32 w = (real32)width;
+    real32 h = (real32)height;
+    // World space is screen space.
+    s->camera = {{w / 2, h / 2}, 1, width, height};
+    s->scratch = create_arena(mem, megabytes(2));
+    uint32 max_vertices = 3 * BENCH_STORM_TRIANGLES + 3 * BENCH_SLIVER_COUNT + 4 * BENCH_TEXTURED_QUADS + 4 * BENCH_ALPHA_LAYERS;
+    s->vb = create_vertexbuffer(mem, max_vertices, VERTEX_LAYOUT_FULL);
+    s->ib.max_count = 2 * max_vertices;
+    s->ib.indices = (uint32 *)get_memory(mem, s->ib.max_count * sizeof(uint32));
+
+    // Small triangles in vertex colors.
+    BenchResult *r = &results[BENCH_POLYGON_STORM];
+    Vertex *vertices = (Vertex *)arena_push(&s->scratch, 3 * BENCH_STORM_TRIANGLES * sizeof(Vertex));
+    uint32 *indices = (uint32 *)arena_push(&s->scratch, 3 * BENCH_STORM_TRIANGLES * sizeof(uint32));
+    for (uint32 i = 0; i < BENCH_STORM_TRIANGLES; i++) {
+        v2 center = {bench_uniform(&state, 0, w), bench_uniform(&state, 0, h)};
+        real32 radius = bench_uniform(&state, 6, 40);
+        for (uint32 j = 0; j < 3; j++) {
+            real32 angle = bench_uniform(&state, 0, 2 * PI);
+            vertices[3 * i + j] = {center + v2{cosf(angle), sinf(angle)} * radius, bench_color(&state, 1), {0, 0}};
+            indices[3 * i + j] = 3 * i + j;
+        }
+        v2 *p = &vertices[3 * i].coord;
+        r->pixels += fabsf(cross(vertices[3 * i + 1].coord - *p, vertices[3 * i + 2].coord - *p)) / 2;
+    }
+    s->storm = create_polygon(&s->vb, &s->ib, vertices, 3 * BENCH_STORM_TRIANGLES, indices, 3 * BENCH_STORM_TRIANGLES);
+    r->primitives = BENCH_STORM_TRIANGLES;
+    r->unit = "triangles";
+    arena_reset(&s->scratch);
+
+    // Long triangles about a pixel wide, where setup outweighs filling.
+    r = &results[BENCH_SLIVERS];
+    vertices = (Vertex *)arena_push(&s->scratch, 3 * BENCH_SLIVER_COUNT * sizeof(Vertex));
+    indices = (uint32 *)arena_push(&s->scratch, 3 * BENCH_SLIVER_COUNT * sizeof(uint32));
+    for (uint32 i = 0; i < BENCH_SLIVER_COUNT; i++) {
+        v2 a = {bench_uniform(&state, 0, w), bench_uniform(&state, 0, h)};
+        real32 angle = bench_uniform(&state, 0, 2 * PI);
+        real32 length = bench_uniform(&state, 100, 500);
+        real32 thickness = bench_uniform(&state, 0.5f, 1.5f);
+        v2 d = {cosf(angle), sinf(angle)};
+        vertices[3 * i] = {a, {1, 1, 1, 1}, {0, 0}};
+        vertices[3 * i + 1] = {a + d * length, {1, 1, 1, 1}, {0, 0}};
+        vertices[3 * i + 2] = {a + v2{-d.y, d.x} * thickness, {1, 1, 1, 1}, {0, 0}};
+        for (uint32 j = 0; j < 3; j++) {
+            indices[3 * i + j] = 3 * i + j;
+        }
+        r->pixels += length * thickness / 2;
+    }
+    s->slivers = create_polygon(&s->vb, &s->ib, vertices, 3 * BENCH_SLIVER_COUNT, indices, 3 * BENCH_SLIVER_COUNT);
+    s->sliver_color = {0.9f, 0.8f, 0.3f, 1};
+    r->primitives = BENCH_SLIVER_COUNT;
+    r->unit = "triangles";
+    arena_reset(&s->scratch);
+
+    // Rotated and scaled quads with a filtered checkerboard.
+    r = &results[BENCH_TEXTURED_MESHES];
+    static constexpr uint32 texture_size = 64;
+    s->texture.pixels = (uint32 *)get_memory(mem, texture_size * texture_size * sizeof(uint32));
+    s->texture.width = texture_size;
+    s->texture.height = texture_size;
+    for (uint32 y = 0; y < texture_size; y++) {
+        for (uint32 x = 0; x < texture_size; x++) {
+            uint32 shade = ((x ^ y) & 8) ? 0xE0 : 0x40;
+            s->texture.pixels[x + y * texture_size] = 0xFF000000 | (shade << 16) | ((x * 4) << 8) | (y * 4);
+        }
+    }
+    texture_create_mips(&s->texture, mem, true);
+    s->textured = build_quads(s, &state, BENCH_TEXTURED_QUADS, 20, 140, &r->pixels);
+    r->primitives = 2 * BENCH_TEXTURED_QUADS;
+    r->unit = "triangles";
+
+    // Translucent layers over most of the screen, for fill rate.
+    r = &results[BENCH_ALPHA_STACK];
+    real32 side = (real32)min(width, height);
+    for (uint32 i = 0; i < BENCH_ALPHA_LAYERS; i++) {
+        s->alpha_quads[i] = build_quads(s, &state, 1, 0.6f * side, side, &r->pixels);
+        s->alpha_colors[i] = bench_color(&state, 0.15f);
+    }
+    r->primitives = 2 * BENCH_ALPHA_LAYERS;
+    r->unit = "triangles";
+
+    r = &results[BENCH_THICK_LINES];
+    for (uint32 i = 0; i < BENCH_LINE_COUNT; i++) {
+        BenchLine *l = &s->lines[i];
+        l->a = {bench_uniform(&state, 0, w), bench_uniform(&state, 0, h)};
+        real32 angle = bench_uniform(&state, 0, 2 * PI);
+        real32 length = bench_uniform(&state, 10, 300);
+        l->b = l->a + v2{cosf(angle), sinf(angle)} * length;
+        l->thickness = 1 + bench_random(&state) % 8;
+        l->color = bench_color(&state, 1);
+        r->pixels += length * l->thickness;
+    }
+    r->primitives = BENCH_LINE_COUNT;
+    r->unit = "lines";
+
+    // A screen of random words.
+    r = &results[BENCH_TEXT];
+    s->font = font;
+    uint32 columns = width / font.cwidth - 1;
+    uint32 rows = height / font.cheight - 1;
+    s->text = (char *)get_memory(mem, rows * (columns + 1) + 1);
+    char *c = s->text;
+    for (uint32 y = 0; y < rows; y++) {
+        for (uint32 x = 0; x < columns; x++) {
+            bool space = bench_random(&state) % 6 == 0;
+            *c++ = space ? ' ' : (char)(33 + bench_random(&state) % 94);
+            r->primitives += !space;
+        }
+        *c++ = '\n';
+    }
+    *c = 0;
+    r->pixels = (real64)r->primitives * font.cwidth * font.cheight;
+    r->unit = "glyphs";
+}
+
+static void
+draw_case(BenchScenes *s, BenchCase c, Framebuffer fb) {
+    Transform identity = {{0, 0}, {1, 1}, 0};
+    switch (c) {
+        case BENCH_POLYGON_STORM:
+            draw_mesh(s->camera, fb, s->storm, identity, 0, 0, &s->scratch);
+            break;
+        case BENCH_SLIVERS:
+            draw_mesh(s->camera, fb, s->slivers, identity, 0, &s->sliver_color, &s->scratch);
+            break;
+        case BENCH_TEXTURED_MESHES:
+            draw_mesh(s->camera, fb, s->textured, identity, &s->texture, 0, &s->scratch);
+            break;
+        case BENCH_ALPHA_STACK:
+            for (uint32 i = 0; i < BENCH_ALPHA_LAYERS; i++) {
+                draw_mesh(s->camera, fb, s->alpha_quads[i], identity, 0, &s->alpha_colors[i], &s->scratch);
+            }
+            break;
+        case BENCH_THICK_LINES:
+            for (uint32 i = 0; i < BENCH_LINE_COUNT; i++) {
+                BenchLine *l = &s->lines[i];
+                draw_line(fb, l->a, l->b, l->color, l->thickness);
+            }
+            break;
+        case BENCH_TEXT:
+            draw_string(fb, s->text, s->font, {0.9f, 0.9f, 0.8f, 1}, 4, 4);
+            break;
+        default:
+            break;
+    }
+}
+
+// Pixels with a channel more than BENCH_TOLERANCE off, all of them if the
+// sizes differ.
+static uint32
+compare_golden(Framebuffer fb, Texture golden) {
+    uint32 count = (uint32)(fb.width * fb.height);
+    if (golden.width != (uint32)fb.width || golden.height != (uint32)fb.height)
+        return count;
+    uint32 mismatches = 0;
+    for (uint32 i = 0; i < count; i++) {
+        uint32 a = fb.data[i];
+        uint32 b = golden.pixels[i];
+        for (uint32 shift = 0; shift < 32; shift += 8) {
+            int32 d = (int32)((a >> shift) & 0xFF) - (int32)((b >> shift) & 0xFF);
+            if (d > BENCH_TOLERANCE || d < -BENCH_TOLERANCE) {
+                mismatches++;
+                break;
+            }
+        }
+    }
+    return mismatches;
+}
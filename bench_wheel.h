@@ -0,0 +1,56 @@
+#ifndef BENCH_WHEEL_H
+
+#include "render_wheel.h"
+#include "memory_wheel.h"
+#include "job_wheel.h"
+
+/* Rasterizer benchmark.
+ *
+ * Draws a fixed catalog of scenes, each made of one kind of primitive, into
+ * an offscreen framebuffer, once directly and once through the tile
+ * renderer. The scenes come from a fixed seed, so every run draws the same
+ * pixels. Each is timed over a number of frames and reported per second in
+ * pixels covered, overdraw included, and in primitives.
+ *
+ * Golden images are BMP files named after the scenes, the ones of the
+ * default window size are kept in golden/. A scene passes when its direct
+ * frame matches the golden image and its tiled frame the direct one, each
+ * with at most one pixel in BENCH_MISMATCH_RATIO that has a channel more
+ * than BENCH_TOLERANCE off, so changes in rounding along edges do not fail
+ * it. A missing golden image fails the scene.
+ */
+#define BENCH_TOLERANCE 2
+#define BENCH_MISMATCH_RATIO 1000
+
+enum BenchCase {
+    BENCH_POLYGON_STORM,
+    BENCH_SLIVERS,
+    BENCH_TEXTURED_MESHES,
+    BENCH_ALPHA_STACK,
+    BENCH_THICK_LINES,
+    BENCH_TEXT,
+    BENCH_CASE_COUNT
+};
+
+struct BenchResult {
+    const char *name;
+    const char *unit; // What the primitives are
+    uint32 primitives; // Per frame
+    real64 pixels; // Per frame
+    real64 seconds; // Fastest frame
+    real64 tiled_seconds; // Fastest frame through the tile renderer
+    bool compared; // Whether there was a golden image
+    uint32 mismatches;
+    uint32 tiled_mismatches; // Against the direct frame
+    bool passed;
+};
+
+// Render every case 'frames' times into a framebuffer of 'width' x
+// 'height', and as often through a tile renderer on 'jobs'. The first direct
+// frame gets compared against the golden images in 'golden_dir', or replaces
+// them if 'record' is set. Returns the number of cases that failed.
+uint32
+bench_run(AppMemory *mem, JobSystem *jobs, Font font, uint32 width, uint32 height, uint32 frames, const char *golden_dir, bool record, BenchResult *results);
+
+#define BENCH_WHEEL_H
+#endif
@@ -9,6 +9,17 @@ gcc \
     scene_wheel.cpp \
     shape_wheel.cpp \
     files_wheel.cpp \
-    -o app -lX11 -lXext -lrt -lm \
+    tile_wheel.cpp \
+    job_wheel.cpp \
+    command_wheel.cpp \
+    layer_wheel.cpp \
+    span_wheel.cpp \
+    batch_wheel.cpp \
+    text_wheel.cpp \
+    hud_wheel.cpp \
+    present_wheel.cpp \
+    atlas_wheel.cpp \
+    bench_wheel.cpp \
+    -o app -lX11 -lXext -lrt -lm -lpthread \
     -g \
     -Wall -Wno-unused-function
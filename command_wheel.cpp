@@ -0,0 +1,316 @@
+#include "command_wheel.h"
+
+static void *
+push_command(RenderCommands *rc, uint64 key, RenderCommandType type, uint64 size);
+
+static void
+sort_entries(RenderCommands *rc);
+
+static bool
+cull_screen(RenderCommands *rc, v2 min, v2 max);
+
+static void
+execute_entry(RenderCommands *rc, Framebuffer fb, RenderEntry *e);
+
+static uint32
+execute_occlusion_passes(RenderCommands *rc, Framebuffer fb);
+
+RenderCommands *
+render_commands_create(AppMemory *mem, uint64 arena_size) {
+    RenderCommands *rc = (RenderCommands *)get_memory(mem, sizeof(RenderCommands));
+    memset(rc, 0, sizeof(*rc));
+    rc->arena = create_arena(mem, arena_size);
+    rc->entries = (RenderEntry *)get_memory(mem, RENDER_MAX_COMMANDS * sizeof(RenderEntry));
+    rc->scratch = (RenderEntry *)get_memory(mem, RENDER_MAX_COMMANDS * sizeof(RenderEntry));
+    return rc;
+}
+
+void
+render_commands_begin(RenderCommands *rc, Framebuffer fb) {
+    arena_reset(&rc->arena);
+    rc->count = 0;
+    rc->dropped = 0;
+    rc->culled = 0;
+    rc->screen.min = {(real32)fb.clip_x0, (real32)fb.clip_y0};
+    // Rasterizers truncate, so everything up to the far clip edge can still
+    // touch the last pixel.
+    rc->screen.max = {(real32)fb.clip_x1, (real32)fb.clip_y1};
+}
+
+bool
+render_cull(RenderCommands *rc, const Camera &camera, BoundingBox bounds) {
+    if (bounding_box_overlap(bounds, camera_world_bounds(camera)))
+        return false;
+    rc->culled++;
+    return true;
+}
+
+void
+render_commands_execute(RenderCommands *rc, Framebuffer fb) {
+    sort_entries(rc);
+    uint32 begin = fb.occlusion ? execute_occlusion_passes(rc, fb) : 0;
+    fb.occlusion_pass = OCCLUSION_NONE;
+    for (uint32 i = begin; i < rc->count; i++) {
+        execute_entry(rc, fb, &rc->entries[i]);
+    }
+}
+
+void
+render_push_clear(RenderCommands *rc, uint64 key, v4 color) {
+    RenderClear *cmd = (RenderClear *)push_command(rc, key, RC_CLEAR, sizeof(RenderClear));
+    if (cmd)
+        cmd->color = color;
+}
+
+void
+render_push_shape(RenderCommands *rc, uint64 key, const Camera &camera, Shape shape, v2 p, real32 p_ang) {
+    RenderShape *cmd = (RenderShape *)push_command(rc, key, RC_SHAPE, sizeof(RenderShape));
+    if (cmd) {
+        cmd->camera = camera;
+        cmd->shape = shape;
+        cmd->p = p;
+        cmd->p_ang = p_ang;
+    }
+}
+
+void
+render_push_mesh(RenderCommands *rc, uint64 key, const Camera &camera, Mesh mesh, Transform t, Texture *texture, v4 *color) {
+    if (render_cull(rc, camera, transform_bounds(mesh.bounds, t)))
+        return;
+    RenderMesh *cmd = (RenderMesh *)push_command(rc, key, RC_MESH, sizeof(RenderMesh));
+    if (cmd) {
+        cmd->camera = camera;
+        cmd->mesh = mesh;
+        cmd->t = t;
+        cmd->texture = texture;
+        cmd->color = color ? *color : v4{};
+        cmd->has_color = color != 0;
+        cmd->wireframe = 0;
+    }
+}
+
+void
+render_push_mesh_wireframe(RenderCommands *rc, uint64 key, const Camera &camera, Mesh mesh, Transform t, v4 color, uint32 thickness) {
+    if (thickness < 1)
+        return;
+    BoundingBox b = transform_bounds(mesh.bounds, t);
+    real32 margin = thickness / camera.scale;
+    b.min -= v2{margin, margin};
+    b.max += v2{margin, margin};
+    if (render_cull(rc, camera, b))
+        return;
+    RenderMesh *cmd = (RenderMesh *)push_command(rc, key, RC_MESH, sizeof(RenderMesh));
+    if (cmd) {
+        cmd->camera = camera;
+        cmd->mesh = mesh;
+        cmd->t = t;
+        cmd->texture = 0;
+        cmd->color = color;
+        cmd->has_color = true;
+        cmd->wireframe = thickness;
+    }
+}
+
+void
+render_push_line(RenderCommands *rc, uint64 key, v2 a, v2 b, v4 color, uint32 thickness) {
+    real32 r = (real32)thickness;
+    if (cull_screen(rc, {min(a.x, b.x) - r, min(a.y, b.y) - r}, {max(a.x, b.x) + r, max(a.y, b.y) + r}))
+        return;
+    RenderLine *cmd = (RenderLine *)push_command(rc, key, RC_LINE, sizeof(RenderLine));
+    if (cmd) {
+        cmd->a = a;
+        cmd->b = b;
+        cmd->color = color;
+        cmd->thickness = thickness;
+    }
+}
+
+void
+render_push_texture(RenderCommands *rc, uint64 key, Texture texture, uint32 x, uint32 y, bool alpha) {
+    render_push_blit(rc, key, texture, x, y, blit_texture(texture, alpha ? BLIT_ALPHA : BLIT_OPAQUE));
+}
+
+void
+render_push_blit(RenderCommands *rc, uint64 key, Texture texture, int32 x, int32 y, const Blit &blit) {
+    if (cull_screen(rc, {(real32)x, (real32)y}, {(real32)(x + (int32)blit.width - 1), (real32)(y + (int32)blit.height - 1)}))
+        return;
+    RenderTexture *cmd = (RenderTexture *)push_command(rc, key, RC_TEXTURE, sizeof(RenderTexture));
+    if (cmd) {
+        cmd->texture = texture;
+        cmd->x = x;
+        cmd->y = y;
+        cmd->blit = blit;
+    }
+}
+
+void
+render_push_sprite(RenderCommands *rc, uint64 key, Texture texture, v2 center, v2 scale, real32 angle, const Blit &blit) {
+    BoundingBox b = sprite_bounds(center, scale, angle, blit);
+    if (cull_screen(rc, b.min, b.max))
+        return;
+    RenderSprite *cmd = (RenderSprite *)push_command(rc, key, RC_SPRITE, sizeof(RenderSprite));
+    if (cmd) {
+        cmd->texture = texture;
+        cmd->center = center;
+        cmd->scale = scale;
+        cmd->angle = angle;
+        cmd->blit = blit;
+    }
+}
+
+void
+render_push_text(RenderCommands *rc, uint64 key, const char *str, Font font, v4 color, int32 x, int32 y) {
+    uint32 width, height;
+    text_size(str, font, &width, &height);
+    v2 min = {(real32)x, (real32)y};
+    v2 max = {(real32)(x + (int32)width - 1), (real32)(y + (int32)height - 1)};
+    if (!width || cull_screen(rc, min, max))
+        return;
+    uint64 length = strlen(str) + 1;
+    RenderText *cmd = (RenderText *)push_command(rc, key, RC_TEXT, sizeof(RenderText) + length);
+    if (cmd) {
+        cmd->font = font;
+        cmd->color = color;
+        cmd->x = x;
+        cmd->y = y;
+        memcpy(cmd + 1, str, length);
+        cmd->str = (const char *)(cmd + 1);
+    }
+}
+
+static void *
+push_command(RenderCommands *rc, uint64 key, RenderCommandType type, uint64 size) {
+    void *data = rc->count < RENDER_MAX_COMMANDS ? arena_push(&rc->arena, size) : 0;
+    if (!data) {
+        rc->dropped++;
+        return 0;
+    }
+    RenderEntry *e = &rc->entries[rc->count++];
+    e->key = key;
+    e->type = type;
+    e->data = data;
+    return data;
+}
+
+static void
+execute_entry(RenderCommands *rc, Framebuffer fb, RenderEntry *e) {
+    switch (e->type) {
+        case RC_CLEAR: {
+            RenderClear *cmd = (RenderClear *)e->data;
+            clear_framebuffer(fb, cmd->color);
+        } break;
+        case RC_SHAPE: {
+            RenderShape *cmd = (RenderShape *)e->data;
+            renderer_draw_shape_to_buffer(fb, cmd->camera, cmd->shape, cmd->p, cmd->p_ang);
+        } break;
+        case RC_MESH: {
+            RenderMesh *cmd = (RenderMesh *)e->data;
+            // The free end of the command arena holds the shaded vertices.
+            if (cmd->wireframe)
+                draw_mesh_wireframe(cmd->camera, fb, cmd->mesh, cmd->t, cmd->color, cmd->wireframe);
+            else
+                draw_mesh(cmd->camera, fb, cmd->mesh, cmd->t, cmd->texture, cmd->has_color ? &cmd->color : 0, &rc->arena);
+        } break;
+        case RC_LINE: {
+            RenderLine *cmd = (RenderLine *)e->data;
+            if (cmd->thickness)
+                draw_line(fb, cmd->a, cmd->b, cmd->color, cmd->thickness);
+            else
+                draw_line(fb, cmd->a, cmd->b, cmd->color);
+        } break;
+        case RC_TEXTURE: {
+            RenderTexture *cmd = (RenderTexture *)e->data;
+            draw_texture(fb, cmd->texture, cmd->x, cmd->y, cmd->blit);
+        } break;
+        case RC_SPRITE: {
+            RenderSprite *cmd = (RenderSprite *)e->data;
+            draw_sprite(fb, cmd->texture, cmd->center, cmd->scale, cmd->angle, cmd->blit);
+        } break;
+        case RC_TEXT: {
+            RenderText *cmd = (RenderText *)e->data;
+            draw_string(fb, cmd->str, cmd->font, cmd->color, cmd->x, cmd->y);
+        } break;
+    }
+}
+
+/* Occlusion culling for the front of the sorted commands.
+ *
+ * The pass covers the commands up to the first one that is not a shape, a
+ * clear or an opaque blit. Everything after that lies in front of the whole
+ * range and is drawn as usual. Within the range the shapes run front to back
+ * first and record what they cover in the span buffer. Then all commands of
+ * the range run in order and skip the pixels covered by shapes in front of
+ * them, which leaves the background only the pixels nothing else covered.
+ * The depth of a command is its index. Returns the number of commands drawn.
+ */
+static uint32
+execute_occlusion_passes(RenderCommands *rc, Framebuffer fb) {
+    if (!span_buffer_fits(fb.occlusion, fb))
+        return 0;
+    uint32 end = 0;
+    bool shapes = false;
+    for (; end < rc->count; end++) {
+        RenderEntry *e = &rc->entries[end];
+        if (e->type == RC_SHAPE)
+            shapes = true;
+        else if (e->type != RC_CLEAR && !(e->type == RC_TEXTURE && ((RenderTexture *)e->data)->blit.mode == BLIT_OPAQUE))
+            break;
+    }
+    if (!shapes)
+        return 0;
+    span_buffer_clear(fb.occlusion);
+    fb.occlusion_pass = OCCLUSION_FRONT;
+    for (uint32 i = end; i-- > 0;) {
+        if (rc->entries[i].type == RC_SHAPE) {
+            fb.depth = i;
+            execute_entry(rc, fb, &rc->entries[i]);
+        }
+    }
+    fb.occlusion_pass = OCCLUSION_BACK;
+    for (uint32 i = 0; i < end; i++) {
+        fb.depth = i;
+        execute_entry(rc, fb, &rc->entries[i]);
+    }
+    return end;
+}
+
+static bool
+cull_screen(RenderCommands *rc, v2 min, v2 max) {
+    if (bounding_box_overlap({min, max}, rc->screen))
+        return false;
+    rc->culled++;
+    return true;
+}
+
+/* Stable LSD radix sort on the keys, one byte per pass.
+ *
+ * Most key bytes are the same for every command in a frame (unused depth
+ * bits, small layer numbers), so passes with a single bucket are skipped.
+ */
+static void
+sort_entries(RenderCommands *rc) {
+    RenderEntry *src = rc->entries;
+    RenderEntry *dst = rc->scratch;
+    for (uint32 shift = 0; shift < 64; shift += 8) {
+        uint32 offsets[256] = {};
+        for (uint32 i = 0; i < rc->count; i++) {
+            offsets[(src[i].key >> shift) & 0xFF]++;
+        }
+        if (rc->count && offsets[(src[0].key >> shift) & 0xFF] == rc->count)
+            continue;
+        uint32 total = 0;
+        for (uint32 b = 0; b < 256; b++) {
+            uint32 count = offsets[b];
+            offsets[b] = total;
+            total += count;
+        }
+        for (uint32 i = 0; i < rc->count; i++) {
+            dst[offsets[(src[i].key >> shift) & 0xFF]++] = src[i];
+        }
+        RenderEntry *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    if (src != rc->entries)
+        memcpy(rc->entries, src, rc->count * sizeof(RenderEntry));
+}
@@ -0,0 +1,156 @@
+#ifndef COMMAND_WHEEL_H
+
+#include "render_wheel.h"
+#include "memory_wheel.h"
+
+#define RENDER_MAX_COMMANDS 16384
+
+/* Render command buffer.
+ *
+ * Draw calls are recorded as small commands with a 64 bit sort key and only
+ * executed when the frame ends. The key is
+ *
+ *     layer (8 bits) | depth (24 bits) | material (32 bits)
+ *
+ * so layers are drawn in order, a layer is drawn back to front by depth, and
+ * commands at the same depth are grouped by material. The sort is stable,
+ * commands with equal keys keep the order they were pushed in.
+ *
+ * Commands that cannot be visible are dropped when they are pushed: world
+ * space objects are tested against the camera's view of the world, screen
+ * space ones against the framebuffer's clip rectangle.
+ */
+enum RenderLayer {
+    LAYER_BACKGROUND,
+    LAYER_WORLD,
+    LAYER_DEBUG,
+    LAYER_UI,
+    LAYER_COUNT
+};
+
+enum RenderCommandType {
+    RC_CLEAR,
+    RC_SHAPE,
+    RC_MESH,
+    RC_LINE,
+    RC_TEXTURE,
+    RC_SPRITE,
+    RC_TEXT
+};
+
+struct RenderClear {
+    v4 color;
+};
+
+struct RenderShape {
+    Camera camera;
+    Shape shape;
+    v2 p;
+    real32 p_ang;
+};
+
+struct RenderMesh {
+    Camera camera;
+    Mesh mesh;
+    Transform t;
+    Texture *texture;
+    v4 color;
+    bool has_color;
+    uint32 wireframe; // Line thickness, 0 for filled meshes
+};
+
+struct RenderLine {
+    v2 a, b;
+    v4 color;
+    uint32 thickness; // 0 for the one pixel variant
+};
+
+struct RenderTexture {
+    Texture texture;
+    int32 x, y;
+    Blit blit;
+};
+
+struct RenderSprite {
+    Texture texture;
+    v2 center;
+    v2 scale;
+    real32 angle;
+    Blit blit;
+};
+
+struct RenderText {
+    Font font;
+    v4 color;
+    int32 x, y;
+    const char *str; // Copied into the command arena
+};
+
+struct RenderEntry {
+    uint64 key;
+    RenderCommandType type;
+    void *data;
+};
+
+struct RenderCommands {
+    MemoryArena arena;
+    RenderEntry *entries;
+    RenderEntry *scratch; // For sorting
+    uint32 count;
+    uint32 dropped; // Commands that did not fit this frame
+    BoundingBox screen; // Clip rectangle of the frame
+    uint32 culled; // Objects culled this frame
+};
+
+inline uint64
+render_key(RenderLayer layer, uint32 depth, uint32 material) {
+    return ((uint64)layer << 56) | ((uint64)(depth & 0xFFFFFF) << 32) | material;
+}
+
+RenderCommands *
+render_commands_create(AppMemory *mem, uint64 arena_size);
+
+void
+render_commands_begin(RenderCommands *rc, Framebuffer fb);
+
+/* Test 'bounds' against the part of the world 'camera' sees.
+ *
+ * Returns true and counts the object as culled if it is not visible, so
+ * callers can skip it before doing any vertex work.
+ */
+bool
+render_cull(RenderCommands *rc, const Camera &camera, BoundingBox bounds);
+
+// Sort the commands and draw them to 'fb', binning them if fb.tiles is set.
+void
+render_commands_execute(RenderCommands *rc, Framebuffer fb);
+
+void
+render_push_clear(RenderCommands *rc, uint64 key, v4 color);
+
+void
+render_push_shape(RenderCommands *rc, uint64 key, const Camera &camera, Shape shape, v2 p, real32 p_ang);
+
+void
+render_push_mesh(RenderCommands *rc, uint64 key, const Camera &camera, Mesh mesh, Transform t, Texture *texture, v4 *color);
+
+void
+render_push_mesh_wireframe(RenderCommands *rc, uint64 key, const Camera &camera, Mesh mesh, Transform t, v4 color, uint32 thickness);
+
+void
+render_push_line(RenderCommands *rc, uint64 key, v2 a, v2 b, v4 color, uint32 thickness);
+
+void
+render_push_texture(RenderCommands *rc, uint64 key, Texture texture, uint32 x, uint32 y, bool alpha);
+
+void
+render_push_blit(RenderCommands *rc, uint64 key, Texture texture, int32 x, int32 y, const Blit &blit);
+
+void
+render_push_sprite(RenderCommands *rc, uint64 key, Texture texture, v2 center, v2 scale, real32 angle, const Blit &blit);
+
+void
+render_push_text(RenderCommands *rc, uint64 key, const char *str, Font font, v4 color, int32 x, int32 y);
+
+#define COMMAND_WHEEL_H
+#endif
@@ -1,8 +1,8 @@
 #include "files_wheel.h"
 
 Texture
-load_bmp_file(const char* filename, AppMemory *mem) {
-    Texture f;
+load_bmp_file(const char* filename, AppMemory *mem, uint32 flags) {
+    Texture f = {};
     FILE *ptr;
     ptr = fopen(filename, "rb");
     if (!ptr) {
@@ -15,15 +15,102 @@ load_bmp_file(const char* filename, AppMemory *mem) {
         exit(1);
     }
     // TODO: More careful compatibility checking
-    uint32 fsize = *(uint32 *)(header + 2);
     uint32 offset = *(uint32 *)(header + 10);
     f.width = *(uint32 *)(header + 18);
     f.height = *(uint32 *)(header + 22);
-    f.bytes = (uint8 *)get_memory(mem, (fsize - offset));
+    f.bytes = (uint8 *)get_memory(mem, f.width * f.height * sizeof(uint32));
     fseek(ptr, offset, SEEK_SET);
     for (uint32 y = f.height; y > 0; y--) {
         fread(f.pixels + (y - 1) * f.width, 4, f.width, ptr);
     }
+    // All textures are kept premultiplied so blending is pure integer math.
+    premultiply_span(f.pixels, f.width * f.height);
     fclose(ptr);
+    if (flags & (TEXTURE_MIPS | TEXTURE_BILINEAR))
+        texture_create_mips(&f, mem, (flags & TEXTURE_BILINEAR) != 0);
     return f;
 };
+
+bool
+save_bmp_file(const char *filename, Texture texture) {
+    FILE *ptr = fopen(filename, "wb");
+    if (!ptr) {
+        printf("File %s could not be opened.\n", filename);
+        return false;
+    }
+    static constexpr uint32 offset = 54;
+    uint32 size = texture.width * texture.height * 4;
+    uint8 header[offset] = {'B', 'M'};
+    *(uint32 *)(header + 2) = offset + size;
+    *(uint32 *)(header + 10) = offset;
+    *(uint32 *)(header + 14) = 40; // Size of the info header
+    *(uint32 *)(header + 18) = texture.width;
+    *(uint32 *)(header + 22) = texture.height;
+    *(uint16 *)(header + 26) = 1; // Planes
+    *(uint16 *)(header + 28) = 32; // Bits per pixel
+    *(uint32 *)(header + 34) = size;
+    bool ok = fwrite(header, 1, offset, ptr) == offset;
+    // Rows go bottom up.
+    for (uint32 y = texture.height; ok && y > 0; y--) {
+        ok = fwrite(texture.pixels + (y - 1) * texture.width, 4, texture.width, ptr) == texture.width;
+    }
+    if (!ok)
+        printf("File %s could not be written.\n", filename);
+    fclose(ptr);
+    return ok;
+}
+
+Font
+load_glyph_font(const char *filename, AppMemory *mem, uint32 cwidth, uint32 cheight) {
+    Font f = {};
+    FILE *ptr = fopen(filename, "rb");
+    if (!ptr) {
+        printf("File %s could not be opened.\n", filename);
+        exit(1);
+    }
+    cwidth = min(cwidth, 32u);
+    f.cwidth = cwidth;
+    f.cheight = cheight;
+    f.row_bytes = (cwidth + 7) / 8;
+    f.ascii_offset = 32;
+    f.glyph_count = 256 - f.ascii_offset;
+    uint64 size = f.glyph_count * cheight * f.row_bytes;
+    f.glyphs = (uint8 *)get_memory(mem, size);
+    memset(f.glyphs, 0, size);
+    uint32 width_mask = cwidth < 32 ? (1u << cwidth) - 1 : 0xFFFFFFFF;
+    int32 c;
+    while ((c = fgetc(ptr)) != EOF) {
+        if (c != '"')
+            continue;
+        c = fgetc(ptr);
+        if (c == '\\')
+            c = fgetc(ptr);
+        if (c == EOF)
+            break;
+        // Decode the rest of a multi-byte character.
+        uint32 code = c;
+        if (c >= 0xC0) {
+            uint32 extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : 1;
+            code = c & (0x3F >> extra);
+            for (uint32 i = 0; i < extra; i++) {
+                code = (code << 6) | (fgetc(ptr) & 0x3F);
+            }
+        }
+        while ((c = fgetc(ptr)) != EOF && c != '[')
+            ;
+        uint8 *rows = code >= f.ascii_offset && code < 256 ? f.glyphs + (code - f.ascii_offset) * cheight * f.row_bytes : 0;
+        uint32 row;
+        for (uint32 y = 0; fscanf(ptr, " %u", &row) == 1; y++) {
+            if (rows && y < cheight) {
+                row &= width_mask;
+                for (uint32 i = 0; i < f.row_bytes; i++) {
+                    rows[y * f.row_bytes + i] = (uint8)(row >> (8 * i));
+                }
+            }
+            if ((c = fgetc(ptr)) != ',')
+                break;
+        }
+    }
+    fclose(ptr);
+    return f;
+}
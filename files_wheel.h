@@ -4,8 +4,31 @@
 #include "memory_wheel.h"
 #include "scene_wheel.h"
 
+// What load_bmp_file builds along with the texels.
+enum TextureLoadFlags {
+    TEXTURE_MIPS = 1 << 0,
+    TEXTURE_BILINEAR = 1 << 1 // Filtered mips, implies TEXTURE_MIPS
+};
+
+// Load a 32-bit BMP as a premultiplied texture, with a mip chain if 'flags'
+// ask for one.
 Texture
-load_bmp_file(const char* filename, AppMemory *mem);
+load_bmp_file(const char* filename, AppMemory *mem, uint32 flags);
+
+// Write 'texture' as a 32-bit BMP that load_bmp_file reads back. Pixels are
+// written as they are, so only opaque ones survive the round trip unchanged.
+bool
+save_bmp_file(const char *filename, Texture texture);
+
+/* Load a font from JSON that maps each character to a list of row bitmasks,
+ * lowest bit leftmost, e.g. "A":[0,0,0,14,17,17,17,31,17,17,0,0].
+ *
+ * Keys are single UTF-8 encoded characters in which only '"' and '\' are
+ * escaped. Characters 32 to 255 are kept as 1-bit glyph masks, others are
+ * skipped. Bits from 'cwidth' on and rows from 'cheight' on are cut off.
+ */
+Font
+load_glyph_font(const char *filename, AppMemory *mem, uint32 cwidth, uint32 cheight);
 
 #define FILES_WHEEL_H
 #endif
@@ -0,0 +1,111 @@
+#include "hud_wheel.h"
+
+static uint32
+format_bytes(char *str, uint64 bytes);
+
+static void
+refresh_text(PerfHud *hud, AppMemory *mem);
+
+PerfHud *
+hud_create(AppMemory *mem) {
+    PerfHud *hud = (PerfHud *)get_memory(mem, sizeof(PerfHud));
+    memset(hud, 0, sizeof(*hud));
+    return hud;
+}
+
+void
+hud_toggle(PerfHud *hud) {
+    bool enabled = !hud->enabled;
+    memset(hud, 0, sizeof(*hud));
+    hud->enabled = enabled;
+    // Show something until the first refresh.
+    strcpy(hud->text, "...");
+}
+
+void
+hud_end_frame(PerfHud *hud, real64 frame_time, AppMemory *mem, uint32 refresh) {
+    if (!hud->enabled)
+        return;
+    hud->frame_ms[hud->frame_index] = (real32)(frame_time * 1000);
+    hud->frame_index = (hud->frame_index + 1) % HUD_HISTORY;
+    for (uint32 i = 0; i < HUD_TIMER_COUNT; i++) {
+        hud->time_sum[i] += hud->time[i];
+        hud->time[i] = 0;
+    }
+    for (uint32 i = 0; i < HUD_COUNTER_COUNT; i++) {
+        hud->count_sum[i] += hud->count[i];
+        hud->count[i] = 0;
+    }
+    hud->frame_sum += frame_time;
+    hud->frames++;
+    if (hud->frames >= refresh)
+        refresh_text(hud, mem);
+}
+
+void
+render_push_hud(RenderCommands *rc, TextCache *tc, PerfHud *hud, Font font, int32 x, int32 y) {
+    if (!hud->enabled)
+        return;
+    static constexpr real32 GRAPH_HEIGHT = 48;
+    // The graph goes up to two frame budgets, with a line at one.
+    real32 budget_ms = 1000.0f / FRAME_RATE;
+    real32 scale = GRAPH_HEIGHT / (2 * budget_ms);
+    real32 bottom = (real32)y + GRAPH_HEIGHT;
+    uint64 key = render_key(LAYER_UI, 0, 0);
+    for (uint32 i = 0; i < HUD_HISTORY; i++) {
+        real32 ms = hud->frame_ms[(hud->frame_index + i) % HUD_HISTORY];
+        if (ms <= 0)
+            continue;
+        real32 height = min(ms * scale, GRAPH_HEIGHT);
+        v4 color = ms > budget_ms ? v4{1, 0.3f, 0.2f, 1} : v4{0.3f, 0.9f, 0.3f, 1};
+        real32 px = (real32)(x + (int32)i);
+        render_push_line(rc, key, {px, bottom}, {px, bottom - height}, color, 0);
+    }
+    real32 budget_y = bottom - budget_ms * scale;
+    render_push_line(rc, key, {(real32)x, budget_y}, {(real32)(x + HUD_HISTORY), budget_y}, {1, 1, 1, 0.5f}, 0);
+    render_push_text_cached(rc, tc, key, hud->text, font, {1, 1, 1, 1}, x, y + (int32)GRAPH_HEIGHT + 4);
+}
+
+// Write 'bytes' with a binary unit and return the length.
+static uint32
+format_bytes(char *str, uint64 bytes) {
+    static const char *units[4] = {"B", "KB", "MB", "GB"};
+    real64 value = (real64)bytes;
+    uint32 unit = 0;
+    while (value >= 1024 && unit < 3) {
+        value /= 1024;
+        unit++;
+    }
+    return sprintf(str, "%.1f %s", value, units[unit]);
+}
+
+static void
+refresh_text(PerfHud *hud, AppMemory *mem) {
+    static const char *timer_names[HUD_TIMER_COUNT] = {"physics", "grid", "bodies", "render"};
+    static const char *tag_names[MEMORY_TAG_COUNT] = {"other", "scene", "render", "text"};
+    real64 n = (real64)hud->frames;
+    char *str = hud->text;
+    real64 fps = hud->frame_sum > 0 ? n / hud->frame_sum : 0;
+    str += sprintf(str, "%.0f fps %.2f ms\n", fps, 1000 * hud->frame_sum / n);
+    for (uint32 i = 0; i < HUD_TIMER_COUNT; i++) {
+        str += sprintf(str, "%-8s %.2f ms\n", timer_names[i], 1000 * hud->time_sum[i] / n);
+        hud->time_sum[i] = 0;
+    }
+    for (uint32 i = 0; i < MEMORY_TAG_COUNT; i++) {
+        str += sprintf(str, "%-8s ", tag_names[i]);
+        str += format_bytes(str, mem->tag_size[i]);
+        *str++ = '\n';
+    }
+    str += sprintf(str, "%-8s ", "total");
+    str += format_bytes(str, mem->used_size);
+    str += sprintf(str, " of ");
+    str += format_bytes(str, mem->total_size);
+    uint32 counts[HUD_COUNTER_COUNT];
+    for (uint32 i = 0; i < HUD_COUNTER_COUNT; i++) {
+        counts[i] = (uint32)(hud->count_sum[i] / hud->frames);
+        hud->count_sum[i] = 0;
+    }
+    sprintf(str, "\ndraws %u culled %u dropped %u\ntiles %u bodies %u", counts[HUD_DRAW_CALLS], counts[HUD_CULLED], counts[HUD_DROPPED], counts[HUD_TILE_COMMANDS], counts[HUD_BODY_COUNT]);
+    hud->frame_sum = 0;
+    hud->frames = 0;
+}
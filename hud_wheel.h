@@ -0,0 +1,95 @@
+#ifndef HUD_WHEEL_H
+
+#include <time.h>
+
+#include "render_wheel.h"
+#include "command_wheel.h"
+#include "text_wheel.h"
+#include "memory_wheel.h"
+
+#define HUD_HISTORY 128
+
+/* Performance overlay.
+ *
+ * Shows a graph of the last HUD_HISTORY frame times, followed by the time
+ * spent in each part of the frame, memory by tag and per frame counters.
+ * The numbers are averaged and only change when the text is refreshed, so
+ * the text block stays cached and is a single blit in between.
+ *
+ * While the overlay is disabled, timers, counters and drawing do nothing.
+ */
+enum HudTimer {
+    HUD_PHYSICS,
+    HUD_GRID,
+    HUD_BODIES,
+    HUD_RENDER,
+    HUD_TIMER_COUNT
+};
+
+enum HudCounter {
+    HUD_DRAW_CALLS,
+    HUD_CULLED,
+    HUD_DROPPED, // Commands that did not fit the buffer
+    HUD_TILE_COMMANDS,
+    HUD_BODY_COUNT,
+    HUD_COUNTER_COUNT
+};
+
+struct PerfHud {
+    bool enabled;
+    real64 begin[HUD_TIMER_COUNT];
+    real64 time[HUD_TIMER_COUNT]; // This frame
+    uint32 count[HUD_COUNTER_COUNT]; // This frame
+    // Sums since the last refresh
+    real64 time_sum[HUD_TIMER_COUNT];
+    uint64 count_sum[HUD_COUNTER_COUNT];
+    real64 frame_sum;
+    uint32 frames;
+    real32 frame_ms[HUD_HISTORY]; // Ring buffer
+    uint32 frame_index;
+    char text[512];
+};
+
+inline real64
+hud_clock() {
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+inline void
+hud_begin(PerfHud *hud, HudTimer timer) {
+    if (hud->enabled)
+        hud->begin[timer] = hud_clock();
+}
+
+inline void
+hud_end(PerfHud *hud, HudTimer timer) {
+    if (hud->enabled)
+        hud->time[timer] += hud_clock() - hud->begin[timer];
+}
+
+inline void
+hud_count(PerfHud *hud, HudCounter counter, uint32 n) {
+    if (hud->enabled)
+        hud->count[counter] += n;
+}
+
+PerfHud *
+hud_create(AppMemory *mem);
+
+// Start over with an empty graph when the overlay gets enabled.
+void
+hud_toggle(PerfHud *hud);
+
+// Record the timers and counters of the frame that took 'frame_time'
+// seconds, refresh the text every 'refresh' frames and reset for the next.
+void
+hud_end_frame(PerfHud *hud, real64 frame_time, AppMemory *mem, uint32 refresh);
+
+// Push the overlay with its top left corner at (x, y).
+void
+render_push_hud(RenderCommands *rc, TextCache *tc, PerfHud *hud, Font font, int32 x, int32 y);
+
+#define HUD_WHEEL_H
+#endif
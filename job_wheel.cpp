@@ -0,0 +1,227 @@
+#include <sched.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#include "job_wheel.h"
+#include "math_wheel.h"
+
+static __thread uint32 job_thread_index;
+
+struct ParallelFor {
+    JobRangeFn fn;
+    void *data;
+    uint32 count;
+    uint32 chunk;
+};
+
+static void *
+job_worker(void *data);
+
+static bool
+job_run_one(JobSystem *js);
+
+static void
+run_job(JobSystem *js, Job job);
+
+static void
+run_range(void *data, uint32 index);
+
+static bool
+deque_push(JobDeque *d, Job job);
+
+static bool
+deque_pop(JobDeque *d, Job *job);
+
+static bool
+deque_steal(JobDeque *d, Job *job);
+
+JobSystem *
+job_system_create(AppMemory *mem) {
+    JobSystem *js = (JobSystem *)get_memory(mem, sizeof(JobSystem));
+    memset(js, 0, sizeof(*js));
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    js->thread_count = (uint32)(cores < 1 ? 1 : (cores > JOB_MAX_THREADS ? JOB_MAX_THREADS : cores));
+    js->deques = (JobDeque *)get_memory(mem, js->thread_count * sizeof(JobDeque));
+    memset(js->deques, 0, js->thread_count * sizeof(JobDeque));
+    pthread_mutex_init(&js->mutex, 0);
+    pthread_cond_init(&js->wake, 0);
+    job_thread_index = 0;
+    for (uint32 i = 1; i < js->thread_count; i++) {
+        if (pthread_create(&js->workers[i], 0, job_worker, js)) {
+            printf("Could not create job worker %d.\n", i);
+            // Threads that did start keep their indices below i.
+            js->thread_count = i;
+            break;
+        }
+    }
+    return js;
+}
+
+void
+job_submit(JobSystem *js, JobFn fn, void *data, uint32 index, JobCounter *counter) {
+    Job job = {fn, data, index, counter};
+    if (counter)
+        __atomic_add_fetch(&counter->value, 1, __ATOMIC_RELAXED);
+    if (!deque_push(&js->deques[job_thread_index], job)) {
+        run_job(js, job);
+        return;
+    }
+    // Pairs with the sleeper check in job_worker, see there.
+    __atomic_add_fetch(&js->queued, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&js->sleepers, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&js->mutex);
+        pthread_cond_signal(&js->wake);
+        pthread_mutex_unlock(&js->mutex);
+    }
+}
+
+void
+job_wait(JobSystem *js, JobCounter *counter) {
+    static constexpr uint32 SPIN_LIMIT = 64;
+    uint32 spins = 0;
+    while (__atomic_load_n(&counter->value, __ATOMIC_ACQUIRE) > 0) {
+        if (job_run_one(js)) {
+            spins = 0;
+            continue;
+        }
+        // The jobs left are running elsewhere. Short ones are worth a few
+        // yields, then the thread sleeps until some counter is done.
+        if (spins < SPIN_LIMIT) {
+            spins++;
+            sched_yield();
+            continue;
+        }
+        // We announce ourselves before checking the counter and run_job
+        // checks for waiters after decrementing it, so one of us always
+        // sees the other.
+        int32 finished = __atomic_load_n(&js->finished, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&js->waiters, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&counter->value, __ATOMIC_SEQ_CST) > 0 && __atomic_load_n(&js->queued, __ATOMIC_SEQ_CST) <= 0)
+            syscall(SYS_futex, &js->finished, FUTEX_WAIT_PRIVATE, finished, 0, 0, 0);
+        __atomic_sub_fetch(&js->waiters, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+void
+job_parallel_for(JobSystem *js, uint32 count, JobRangeFn fn, void *data) {
+    // A few chunks per thread leave room to balance uneven work without
+    // paying for a job per element.
+    uint32 chunk = max(count / (js->thread_count * 4), 1u);
+    ParallelFor pf = {fn, data, count, chunk};
+    uint32 chunk_count = (count + chunk - 1) / chunk;
+    if (chunk_count <= 1) {
+        if (count)
+            fn(data, 0, count);
+        return;
+    }
+    JobCounter counter = {};
+    for (uint32 i = 0; i < chunk_count; i++) {
+        job_submit(js, run_range, &pf, i, &counter);
+    }
+    job_wait(js, &counter);
+}
+
+static void *
+job_worker(void *data) {
+    JobSystem *js = (JobSystem *)data;
+    job_thread_index = __atomic_add_fetch(&js->started, 1, __ATOMIC_RELAXED);
+    for (;;) {
+        if (job_run_one(js))
+            continue;
+        // A submitter increments 'queued' before it looks at 'sleepers' and
+        // we do it the other way round, so one of us always sees the other.
+        pthread_mutex_lock(&js->mutex);
+        __atomic_add_fetch(&js->sleepers, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&js->queued, __ATOMIC_SEQ_CST) <= 0) {
+            pthread_cond_wait(&js->wake, &js->mutex);
+        }
+        __atomic_sub_fetch(&js->sleepers, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&js->mutex);
+    }
+    return 0;
+}
+
+static bool
+job_run_one(JobSystem *js) {
+    uint32 self = job_thread_index;
+    Job job;
+    bool found = deque_pop(&js->deques[self], &job);
+    for (uint32 i = 1; !found && i < js->thread_count; i++) {
+        found = deque_steal(&js->deques[(self + i) % js->thread_count], &job);
+    }
+    if (!found)
+        return false;
+    __atomic_sub_fetch(&js->queued, 1, __ATOMIC_SEQ_CST);
+    run_job(js, job);
+    return true;
+}
+
+// The counter may be gone as soon as it reaches zero, so waiters are woken
+// through the job system instead.
+static void
+run_job(JobSystem *js, Job job) {
+    job.fn(job.data, job.index);
+    if (job.counter && __atomic_sub_fetch(&job.counter->value, 1, __ATOMIC_SEQ_CST) == 0 &&
+        __atomic_load_n(&js->waiters, __ATOMIC_SEQ_CST)) {
+        __atomic_add_fetch(&js->finished, 1, __ATOMIC_SEQ_CST);
+        syscall(SYS_futex, &js->finished, FUTEX_WAKE_PRIVATE, 0x7FFFFFFF, 0, 0, 0);
+    }
+}
+
+static void
+run_range(void *data, uint32 index) {
+    ParallelFor *pf = (ParallelFor *)data;
+    uint32 begin = index * pf->chunk;
+    pf->fn(pf->data, begin, min(begin + pf->chunk, pf->count));
+}
+
+/* Chase-Lev deque operations.
+ *
+ * See Chase and Lev, "Dynamic Circular Work-Stealing Deque", and Le et al.,
+ * "Correct and Efficient Work-Stealing for Weak Memory Models". The buffer
+ * does not grow, push fails instead.
+ */
+static bool
+deque_push(JobDeque *d, Job job) {
+    int64 b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    int64 t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    if (b - t >= JOB_DEQUE_SIZE)
+        return false;
+    d->jobs[b & (JOB_DEQUE_SIZE - 1)] = job;
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static bool
+deque_pop(JobDeque *d, Job *job) {
+    int64 b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64 t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+    if (t > b) {
+        // Empty
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    *job = d->jobs[b & (JOB_DEQUE_SIZE - 1)];
+    if (t == b) {
+        // Last job, race against thieves for it.
+        bool won = __atomic_compare_exchange_n(&d->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+        return won;
+    }
+    return true;
+}
+
+static bool
+deque_steal(JobDeque *d, Job *job) {
+    int64 t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64 b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+    if (t >= b)
+        return false;
+    // The copy is only used if nobody moved 'top' in the meantime.
+    *job = d->jobs[t & (JOB_DEQUE_SIZE - 1)];
+    return __atomic_compare_exchange_n(&d->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,83 @@
+#ifndef JOB_WHEEL_H
+
+#include <pthread.h>
+
+#include "types_wheel.h"
+#include "memory_wheel.h"
+
+#define JOB_MAX_THREADS 32
+#define JOB_DEQUE_SIZE 1024 // Must be a power of two
+
+/* Work-stealing job system.
+ *
+ * Every thread owns a Chase-Lev deque. The owner pushes and pops jobs at the
+ * bottom, idle threads steal from the top of other deques. Thread 0 is the
+ * main thread, which does not get a worker of its own but runs jobs whenever
+ * it waits for a counter.
+ *
+ * Jobs may only be submitted from the main thread or from inside jobs.
+ */
+typedef void (*JobFn)(void *data, uint32 index);
+
+// Handles the elements [begin, end) of a job_parallel_for.
+typedef void (*JobRangeFn)(void *data, uint32 begin, uint32 end);
+
+// Number of unfinished jobs submitted with this counter.
+struct JobCounter {
+    int32 value;
+};
+
+struct Job {
+    JobFn fn;
+    void *data;
+    uint32 index;
+    JobCounter *counter;
+};
+
+struct JobDeque {
+    int64 top;
+    uint8 top_padding[56];
+    int64 bottom;
+    uint8 bottom_padding[56];
+    Job jobs[JOB_DEQUE_SIZE];
+};
+
+struct JobSystem {
+    JobDeque *deques;
+    uint32 thread_count; // Including the main thread
+    pthread_t workers[JOB_MAX_THREADS];
+    uint32 started;
+    // Idle workers sleep until something is queued.
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    int32 queued;
+    int32 sleepers;
+    // Threads blocked in job_wait sleep on 'finished', which changes
+    // whenever a counter drops to zero while one of them is waiting.
+    int32 finished;
+    int32 waiters;
+};
+
+JobSystem *
+job_system_create(AppMemory *mem);
+
+/* Queue fn(data, index) on the calling thread's deque.
+ *
+ * If 'counter' is set it is incremented now and decremented once the job has
+ * finished. If the deque is full the job runs right away.
+ */
+void
+job_submit(JobSystem *js, JobFn fn, void *data, uint32 index, JobCounter *counter);
+
+// Run other jobs until 'counter' drops to zero, and sleep while there are
+// none.
+void
+job_wait(JobSystem *js, JobCounter *counter);
+
+// Split [0, count) into a few ranges per thread, run fn(data, begin, end) on
+// them in parallel and wait for all of them. A single range runs right away.
+void
+job_parallel_for(JobSystem *js, uint32 count, JobRangeFn fn, void *data);
+
+#define JOB_WHEEL_H
+#endif
@@ -0,0 +1,111 @@
+#include "layer_wheel.h"
+
+static void
+redraw_rect(CachedLayer *layer, int32 x0, int32 y0, int32 x1, int32 y1);
+
+static void
+scroll_texture(Texture texture, int32 dx, int32 dy);
+
+CachedLayer *
+layer_create(AppMemory *mem, uint32 width, uint32 height, LayerDrawFn draw, void *data) {
+    CachedLayer *layer = (CachedLayer *)get_memory(mem, sizeof(CachedLayer));
+    memset(layer, 0, sizeof(*layer));
+    layer->texture.pixels = (uint32 *)get_memory(mem, width * height * sizeof(uint32));
+    layer->texture.width = width;
+    layer->texture.height = height;
+    layer->draw = draw;
+    layer->data = data;
+    // A layer's draw calls only need a fraction of the frame's command space.
+    layer->commands = render_commands_create(mem, kilobytes(256));
+    return layer;
+}
+
+Texture
+layer_update(CachedLayer *layer, const Camera &camera) {
+    int32 w = layer->texture.width;
+    int32 h = layer->texture.height;
+    bool redraw = !layer->valid || camera.scale != layer->camera.scale || camera.width != layer->camera.width || camera.height != layer->camera.height;
+    if (!redraw) {
+        // Content moves opposite to the camera.
+        v2 d = (layer->camera.pos - camera.pos) * camera.scale;
+        real32 x_rounded = roundf(d.x);
+        real32 y_rounded = roundf(d.y);
+        // Mouse pans are whole pixels up to float error. Far from the last
+        // full redraw the float coordinates lose precision, so start over.
+        if (abs(d.x - x_rounded) > 0.01f || abs(d.y - y_rounded) > 0.01f || abs(x_rounded) > 65536.0f || abs(y_rounded) > 65536.0f) {
+            redraw = true;
+        }
+        else {
+            int32 dx = (int32)x_rounded - layer->scroll_x;
+            int32 dy = (int32)y_rounded - layer->scroll_y;
+            layer->scroll_x += dx;
+            layer->scroll_y += dy;
+            if (abs(dx) >= w || abs(dy) >= h) {
+                redraw_rect(layer, 0, 0, w, h);
+            }
+            else if (dx || dy) {
+                scroll_texture(layer->texture, dx, dy);
+                if (dx > 0)
+                    redraw_rect(layer, 0, 0, dx, h);
+                else if (dx < 0)
+                    redraw_rect(layer, w + dx, 0, w, h);
+                if (dy > 0)
+                    redraw_rect(layer, 0, 0, w, dy);
+                else if (dy < 0)
+                    redraw_rect(layer, 0, h + dy, w, h);
+                layer->scrolls++;
+            }
+        }
+    }
+    if (redraw) {
+        layer->camera = camera;
+        layer->scroll_x = 0;
+        layer->scroll_y = 0;
+        redraw_rect(layer, 0, 0, w, h);
+        layer->valid = true;
+        layer->redraws++;
+    }
+    return layer->texture;
+}
+
+// Redraw the texture rectangle [x0, x1) x [y0, y1).
+static void
+redraw_rect(CachedLayer *layer, int32 x0, int32 y0, int32 x1, int32 y1) {
+    // Draw with the camera of the last full redraw moved along with the
+    // content, so that strips line up with the scrolled pixels.
+    Camera camera = layer->camera;
+    camera.pos.x -= (real32)layer->scroll_x / camera.scale;
+    camera.pos.y -= (real32)layer->scroll_y / camera.scale;
+    Framebuffer fb = {};
+    fb.data = layer->texture.pixels;
+    fb.width = layer->texture.width;
+    fb.height = layer->texture.height;
+    fb.bytes_per_pixel = 4;
+    fb.clip_x0 = x0;
+    fb.clip_y0 = y0;
+    fb.clip_x1 = x1;
+    fb.clip_y1 = y1;
+    render_commands_begin(layer->commands, fb);
+    layer->draw(layer->commands, camera, layer->data);
+    render_commands_execute(layer->commands, fb);
+}
+
+// Move the contents by (dx, dy) pixels. The uncovered strips keep stale data.
+static void
+scroll_texture(Texture texture, int32 dx, int32 dy) {
+    int32 w = texture.width;
+    int32 h = texture.height;
+    int32 count = w - abs(dx);
+    int32 src_x = max(-dx, 0);
+    int32 dst_x = max(dx, 0);
+    // Walk rows against the direction of movement so nothing is overwritten
+    // before it has been moved.
+    if (dy > 0) {
+        for (int32 y = h - 1; y >= dy; y--)
+            memmove(texture.pixels + dst_x + y * w, texture.pixels + src_x + (y - dy) * w, count * sizeof(uint32));
+    }
+    else {
+        for (int32 y = 0; y < h + dy; y++)
+            memmove(texture.pixels + dst_x + y * w, texture.pixels + src_x + (y - dy) * w, count * sizeof(uint32));
+    }
+}
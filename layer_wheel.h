@@ -0,0 +1,48 @@
+#ifndef LAYER_WHEEL_H
+
+#include "render_wheel.h"
+#include "command_wheel.h"
+#include "memory_wheel.h"
+
+/* Cached offscreen layer.
+ *
+ * A layer records its draw calls through 'draw' and renders them into its own
+ * texture, which is then composited with a plain blit every frame. The
+ * texture is only redrawn when the camera zooms, the layer is invalidated or
+ * the camera moves by a fractional number of pixels. Whole pixel pans scroll
+ * the texture and only redraw the strips that scrolled into view.
+ *
+ * Strips are drawn with the camera of the last full redraw, moved by the
+ * scroll offset. Recomputing them from the current camera would round
+ * differently now and then and leave seams.
+ */
+typedef void (*LayerDrawFn)(RenderCommands *rc, const Camera &camera, void *data);
+
+struct CachedLayer {
+    Texture texture;
+    Camera camera; // Camera of the last full redraw
+    int32 scroll_x, scroll_y; // Pixels the content moved since then
+    bool valid;
+    LayerDrawFn draw;
+    void *data;
+    RenderCommands *commands;
+    // Statistics since the layer was created
+    uint32 redraws;
+    uint32 scrolls;
+};
+
+CachedLayer *
+layer_create(AppMemory *mem, uint32 width, uint32 height, LayerDrawFn draw, void *data);
+
+// Force a full redraw, e.g. because the content changed.
+inline void
+layer_invalidate(CachedLayer *layer) {
+    layer->valid = false;
+}
+
+// Bring the texture up to date for 'camera' and return it.
+Texture
+layer_update(CachedLayer *layer, const Camera &camera);
+
+#define LAYER_WHEEL_H
+#endif
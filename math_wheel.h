@@ -212,7 +212,7 @@ dot(v2 a, v2 b) {
 
 inline float
 cross(v2 a, v2 b) {
-    return a.x * b.y - a.y - b.x;
+    return a.x * b.y - a.y * b.x;
 }
 
 inline float
@@ -3,12 +3,23 @@
 #include <stdio.h>
 #include <string.h>
 
+// What memory is used for, for statistics.
+enum MemoryTag {
+    MEMORY_OTHER,
+    MEMORY_SCENE,
+    MEMORY_RENDER,
+    MEMORY_TEXT,
+    MEMORY_TAG_COUNT
+};
+
 struct AppMemory {
     uint64 total_size;
     uint64 used_size;
     uint64 fragmented;
-    void *data;
+    void *data; // Where the first allocation lands
     void *free;
+    MemoryTag tag; // Charged with allocations
+    uint64 tag_size[MEMORY_TAG_COUNT];
 };
 
 /* A block of free memory of arbitrary size.
@@ -21,6 +32,17 @@ struct FreeMemoryBlock {
     FreeMemoryBlock *next;
 };
 
+/* Bookkeeping in front of every allocation.
+ *
+ * Frees go to the tag the allocation was charged to, whatever the current tag
+ * is by then. A freed block, header included, becomes a FreeMemoryBlock, so
+ * even the smallest allocation has room for one.
+ */
+struct AllocationHeader {
+    uint64 size; // Header included, a multiple of the header size
+    uint64 tag;
+};
+
 /* Initialize memory.
  *
  * The system allocates mem_size bytes of memory, sets all bytes to zero and
@@ -36,44 +58,51 @@ initialize_memory(uint64 mem_size) {
     memset(mem, 0, mem_size);
     mem->total_size = mem_size;
     mem->used_size = 0;
-    mem->data = (void *)(mem + 1);
-    mem->free = mem->data;
+    mem->free = (void *)(mem + 1);
+    mem->data = (char *)mem->free + sizeof(AllocationHeader);
     FreeMemoryBlock *block = ((FreeMemoryBlock *)mem->free);
-    block->size = mem_size;
+    block->size = (mem_size - sizeof(AppMemory)) & ~(uint64)(sizeof(AllocationHeader) - 1);
     block->next = 0;
     return mem;
 }
 
-/* Free 'size' bytes of memory in '*mem'.
+/* Free the 'size' bytes at 'ptr', which came from get_memory on '*mem'.
  *
- * The location at 'ptr' gets initialized to a free memory block of size 'size'
- * that points to the previously most recent FreeMemoryBlock.
+ * The block at 'ptr', header included, gets initialized to a free memory
+ * block that points to the previously most recent FreeMemoryBlock.
  *
  * TODO: Join adjacent memory blocks.
  */
 inline void
 free_memory(AppMemory *mem, void *ptr, uint64 size) {
-    FreeMemoryBlock *new_free = (FreeMemoryBlock *) ptr;
-    new_free->size = size;
+    AllocationHeader *header = (AllocationHeader *)ptr - 1;
+    uint64 block_size = header->size;
+    uint64 tag = header->tag;
+    assert(size + sizeof(AllocationHeader) <= block_size && tag < MEMORY_TAG_COUNT);
+    FreeMemoryBlock *new_free = (FreeMemoryBlock *)header;
+    new_free->size = block_size;
     new_free->next = (FreeMemoryBlock *)mem->free;
     mem->free = new_free;
-    mem->used_size -= size;
+    mem->used_size -= block_size;
+    mem->tag_size[tag] -= block_size;
     if (!(((FreeMemoryBlock *)(mem->free))->next)) {
-        mem->fragmented -= size;
+        mem->fragmented -= block_size;
     }
 }
 
 /* Get 'size' bytes of memory from '*mem'.
  * 
  * Loop over free memory blocks to find the first one that has the sufficient
- * size.
+ * size for the allocation and its header.
  */
 inline void*
 get_memory(AppMemory *mem, uint64 size) {
+    // Whole headers, so that every block and what it holds stays aligned.
+    uint64 block_size = (size + 2 * sizeof(AllocationHeader) - 1) & ~(uint64)(sizeof(AllocationHeader) - 1);
     FreeMemoryBlock *first = (FreeMemoryBlock *)mem->free;
     FreeMemoryBlock *candidate = first;
     FreeMemoryBlock *previous = first;
-    while (candidate->size < size) {
+    while (candidate->size < block_size) {
         if (candidate->next) {
             previous = candidate;
             candidate = candidate->next;
@@ -83,14 +112,14 @@ get_memory(AppMemory *mem, uint64 size) {
             exit(1);
         }
     }
-    mem->used_size += size;
-    mem->fragmented += size;
     FreeMemoryBlock *new_free;
-    if (candidate->size - size >= sizeof(FreeMemoryBlock)) {
-        new_free = (FreeMemoryBlock *)((char *)candidate + size);
+    if (candidate->size - block_size >= sizeof(FreeMemoryBlock)) {
+        new_free = (FreeMemoryBlock *)((char *)candidate + block_size);
         new_free->next = candidate->next;
-        new_free->size = candidate->size - size;
+        new_free->size = candidate->size - block_size;
     } else {
+        // The rest is too small to be a block of its own.
+        block_size = candidate->size;
         new_free = candidate->next;
     }
     if (candidate == first) {
@@ -100,7 +129,62 @@ get_memory(AppMemory *mem, uint64 size) {
         previous->next = new_free;
         ;
     }
-    return (void *)candidate;
+    mem->used_size += block_size;
+    mem->tag_size[mem->tag] += block_size;
+    mem->fragmented += block_size;
+    AllocationHeader *header = (AllocationHeader *)candidate;
+    header->size = block_size;
+    header->tag = mem->tag;
+    return (void *)(header + 1);
+}
+
+/* A linear allocator for data that lives for a frame or less.
+ *
+ * The arena takes one block from AppMemory up front. Allocations only bump an
+ * offset and everything is released at once with arena_reset.
+ */
+struct MemoryArena {
+    uint8 *base;
+    uint64 size;
+    uint64 used;
+};
+
+inline MemoryArena
+create_arena(AppMemory *mem, uint64 size) {
+    MemoryArena arena = {};
+    arena.base = (uint8 *)get_memory(mem, size);
+    arena.size = size;
+    return arena;
+}
+
+inline uint64
+arena_remaining(MemoryArena *arena) {
+    return arena->size - arena->used;
+}
+
+/* Get 'size' bytes from '*arena', aligned to 16 bytes.
+ *
+ * Returns 0 if the arena is exhausted, so that callers can flush and retry.
+ */
+inline void *
+arena_push(MemoryArena *arena, uint64 size) {
+    uint64 address = (uint64)(arena->base + arena->used);
+    uint64 offset = arena->used + (((address + 15) & ~(uint64)15) - address);
+    if (offset + size > arena->size)
+        return 0;
+    arena->used = offset + size;
+    return arena->base + offset;
+}
+
+inline void
+arena_reset(MemoryArena *arena) {
+    arena->used = 0;
+}
+
+// Release everything pushed since arena->used was 'mark'.
+inline void
+arena_rewind(MemoryArena *arena, uint64 mark) {
+    arena->used = mark;
 }
 
 #define MEMORY_WHEEL_H
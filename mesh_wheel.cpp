@@ -1,13 +1,45 @@
 #include <string.h>
 #include "mesh_wheel.h"
 
+static bool
+is_ear(const v2 *vertices, const uint32 *remaining, uint32 n, uint32 i, real32 winding);
+
+Vertexbuffer
+create_vertexbuffer(AppMemory *mem, uint32 max_count, uint32 layout) {
+    Vertexbuffer vb = {};
+    vb.max_count = max_count;
+    vb.streams.positions = (v2 *)get_memory(mem, max_count * sizeof(v2));
+    if (layout & VERTEX_COLOR)
+        vb.streams.colors = (uint32 *)get_memory(mem, max_count * sizeof(uint32));
+    if (layout & VERTEX_TEX_COORD)
+        vb.streams.tex_coords = (PackedTexCoord *)get_memory(mem, max_count * sizeof(PackedTexCoord));
+    return vb;
+}
+
 Mesh
 create_polygon(Vertexbuffer *vb, Indexbuffer *ib, const Vertex *verts, uint32 count_v, const uint32 *indices, uint32 count_i) {
     Mesh mesh = {};
-    mesh.v_buffer = vb->data;
+    mesh.vertices = vb->streams;
     mesh.index_count = count_i;
     mesh.i = ib->indices + ib->count;
-    memcpy(vb->data + vb->count, verts, count_v * sizeof(*verts));
+    mesh.first_vertex = vb->count;
+    mesh.vertex_count = count_v;
+    VertexStreams *v = &vb->streams;
+    for (uint32 i = 0; i < count_v; i++) {
+        uint32 j = vb->count + i;
+        v->positions[j] = verts[i].coord;
+        if (v->colors)
+            v->colors[j] = pack_vertex_color(verts[i].color);
+        if (v->tex_coords)
+            v->tex_coords[j] = pack_tex_coord(verts[i].tex_coord);
+    }
+    mesh.bounds = {verts[0].coord, verts[0].coord};
+    for (uint32 i = 1; i < count_v; i++) {
+        mesh.bounds.min.x = min(mesh.bounds.min.x, verts[i].coord.x);
+        mesh.bounds.min.y = min(mesh.bounds.min.y, verts[i].coord.y);
+        mesh.bounds.max.x = max(mesh.bounds.max.x, verts[i].coord.x);
+        mesh.bounds.max.y = max(mesh.bounds.max.y, verts[i].coord.y);
+    }
     memcpy(mesh.i, indices, count_i * sizeof(*indices));
     for (uint32 i = 0; i < count_i; i++) {
         mesh.i[i] += vb->count;
@@ -39,13 +71,121 @@ create_rectangle(Vertexbuffer *vb, Indexbuffer *ib, v2 min, v2 max, v4 color) {
     return create_polygon(vb, ib, verts, 4, indices, 6);
 };
 
+uint32
+triangulate_polygon(const v2 *vertices, uint32 count, uint32 *indices) {
+    if (count < 3)
+        return 0;
+    uint32 index_count = 0;
+    if (polygon_is_convex(vertices, count)) {
+        for (uint32 i = 1; i + 1 < count; i++) {
+            indices[index_count++] = 0;
+            indices[index_count++] = i;
+            indices[index_count++] = i + 1;
+        }
+        return index_count;
+    }
+    assert(count <= MAX_TRIANGULATE_VERTICES);
+    // Twice the signed area tells the winding, which convex corners share.
+    real32 winding = 0;
+    for (uint32 i = 0; i < count; i++) {
+        winding += cross(vertices[i], vertices[(i + 1) % count]);
+    }
+    uint32 remaining[MAX_TRIANGULATE_VERTICES];
+    for (uint32 i = 0; i < count; i++) {
+        remaining[i] = i;
+    }
+    uint32 n = count;
+    uint32 i = 0;
+    uint32 misses = 0;
+    while (n > 3) {
+        // A full round without an ear means the outline is not simple, the
+        // corner gets clipped anyway so that every vertex ends up used.
+        if (is_ear(vertices, remaining, n, i, winding) || misses == n) {
+            indices[index_count++] = remaining[(i + n - 1) % n];
+            indices[index_count++] = remaining[i];
+            indices[index_count++] = remaining[(i + 1) % n];
+            n--;
+            memmove(remaining + i, remaining + i + 1, (n - i) * sizeof(uint32));
+            i %= n;
+            misses = 0;
+        }
+        else {
+            i = (i + 1) % n;
+            misses++;
+        }
+    }
+    indices[index_count++] = remaining[0];
+    indices[index_count++] = remaining[1];
+    indices[index_count++] = remaining[2];
+    return index_count;
+}
+
+ShapeMeshCache *
+shape_mesh_cache_create(AppMemory *mem, uint32 max_vertices, uint32 max_indices) {
+    ShapeMeshCache *cache = (ShapeMeshCache *)get_memory(mem, sizeof(ShapeMeshCache));
+    memset(cache, 0, sizeof(*cache));
+    cache->vb = create_vertexbuffer(mem, max_vertices, 0);
+    cache->ib.indices = (uint32 *)get_memory(mem, max_indices * sizeof(uint32));
+    cache->ib.max_count = max_indices;
+    return cache;
+}
+
+const ShapeMesh *
+shape_mesh_get(ShapeMeshCache *cache, const Shape &shape, uint32 index) {
+    if (shape.type != ST_POLYGON || shape.polygon.convex || shape.polygon.count < 3)
+        return 0;
+    assert(index < MAX_SHAPE_COUNT);
+    const v2 *outline = shape.polygon.vertices;
+    uint32 count = shape.polygon.count;
+    ShapeMesh *e = &cache->entries[index];
+    if (e->outline == outline && e->count == count)
+        return e;
+    // Replaced meshes stay in the buffers, shapes are hardly ever replaced.
+    uint32 max_indices = 3 * (count - 2);
+    if (cache->vb.count + count > cache->vb.max_count || cache->ib.count + max_indices > cache->ib.max_count)
+        return 0;
+    Vertex vertices[MAX_TRIANGULATE_VERTICES];
+    uint32 indices[3 * MAX_TRIANGULATE_VERTICES];
+    assert(count <= MAX_TRIANGULATE_VERTICES);
+    for (uint32 i = 0; i < count; i++) {
+        vertices[i] = {outline[i], {1, 1, 1, 1}, {0, 0}};
+    }
+    uint32 index_count = triangulate_polygon(outline, count, indices);
+    e->outline = outline;
+    e->count = count;
+    e->mesh = create_polygon(&cache->vb, &cache->ib, vertices, count, indices, index_count);
+    return e;
+}
+
+// Whether the corner at remaining[i] can be clipped: it turns like the
+// outline and no other vertex lies in the triangle it spans.
+static bool
+is_ear(const v2 *vertices, const uint32 *remaining, uint32 n, uint32 i, real32 winding) {
+    v2 a = vertices[remaining[(i + n - 1) % n]];
+    v2 b = vertices[remaining[i]];
+    v2 c = vertices[remaining[(i + 1) % n]];
+    if (cross(b - a, c - b) * winding <= 0)
+        return false;
+    for (uint32 j = 0; j < n; j++) {
+        if (j == i || j == (i + 1) % n || j == (i + n - 1) % n)
+            continue;
+        v2 p = vertices[remaining[j]];
+        real32 ab = cross(b - a, p - a) * winding;
+        real32 bc = cross(c - b, p - b) * winding;
+        real32 ca = cross(a - c, p - c) * winding;
+        if (ab >= 0 && bc >= 0 && ca >= 0)
+            return false;
+    }
+    return true;
+}
+
 v2
 center_of_mass(Mesh mesh) {
 // TODO: This is wrong! We should only count every vertex once!
     v2 sum = {};
     uint32 i;
     for (i = 0; i < mesh.index_count; i++) {
-        sum += mesh.v_buffer[mesh.i[i]].coord;
+        sum += mesh.vertices.positions[mesh.i[i]];
     }
     return sum / (real32)i;
 }
@@ -55,6 +195,21 @@ transform(v2 v, Transform t) {
     return rotate(hadamard(v, t.scale), {0, 0}, t.rot) + t.pos;
 }
 
+BoundingBox
+transform_bounds(BoundingBox b, Transform t) {
+    v2 corners[4] = {b.min, {b.max.x, b.min.y}, b.max, {b.min.x, b.max.y}};
+    BoundingBox result;
+    result.min = result.max = transform(corners[0], t);
+    for (uint32 i = 1; i < 4; i++) {
+        v2 c = transform(corners[i], t);
+        result.min.x = min(result.min.x, c.x);
+        result.min.y = min(result.min.y, c.y);
+        result.max.x = max(result.max.x, c.x);
+        result.max.y = max(result.max.y, c.y);
+    }
+    return result;
+}
+
 v2
 world_to_object_space(v2 v, Transform t) {
     return hadamard(rotate(v - t.pos, {0, 0}, -t.rot), 1/t.scale);
@@ -67,9 +222,9 @@ is_in_mesh(v2 p, Mesh mesh, Transform t) {
     bool result = false;
     for (uint32 i = 0; i < mesh.index_count - 2; i += 3) {
         result = is_in_triangle(p,
-                transform(mesh.v_buffer[mesh.i[i]].coord, t),
-                transform(mesh.v_buffer[mesh.i[i + 1]].coord, t),
-                transform(mesh.v_buffer[mesh.i[i + 2]].coord, t));
+                transform(mesh.vertices.positions[mesh.i[i]], t),
+                transform(mesh.vertices.positions[mesh.i[i + 1]], t),
+                transform(mesh.vertices.positions[mesh.i[i + 2]], t));
         if (result)
             return result;
     }
@@ -3,18 +3,54 @@
 #include <float.h>
 
 #include "math_wheel.h"
+#include "shape_wheel.h"
+#include "memory_wheel.h"
 
-// TODO: Probably don't want to hard-code the vertex attributes. Otherwise I
-// have to change the create_mesh functions every time I add a new vertex
-// attribute.
+#define TEX_COORD_ONE 1024
+#define MAX_TRIANGULATE_VERTICES 256
+
+/* Vertex streams.
+ *
+ * Every vertex attribute lives in a stream of its own, so passes that only
+ * need positions, like physics, culling and wireframes, do not pull the other
+ * attributes through the cache. The layout of a buffer says which streams it
+ * has, attributes it lacks read as opaque white and (0, 0).
+ *
+ * Colors are packed to 0xAARRGGBB with straight alpha. Texture coordinates
+ * are stored in 16 bits per component as multiples of 1 / TEX_COORD_ONE,
+ * which covers [0, 64): a rectangle from create_rectangle can be 64 times as
+ * long as it is wide, and the step is a texel of a 1024 pixel texture. A
+ * vertex takes 16 bytes, 8 of them in passes that only read positions.
+ *
+ * A new attribute needs a layout bit, a stream, a line in create_polygon and
+ * an accessor.
+ */
+enum VertexAttribute {
+    VERTEX_COLOR = 1 << 0,
+    VERTEX_TEX_COORD = 1 << 1
+};
+
+#define VERTEX_LAYOUT_FULL (VERTEX_COLOR | VERTEX_TEX_COORD)
+
+// Unpacked vertex, the input of create_polygon.
 struct Vertex {
     v2 coord;
     v4 color;
     v2 tex_coord;
 };
 
+struct PackedTexCoord {
+    uint16 u, v;
+};
+
+struct VertexStreams {
+    v2 *positions;
+    uint32 *colors; // 0 without VERTEX_COLOR
+    PackedTexCoord *tex_coords; // 0 without VERTEX_TEX_COORD
+};
+
 struct Vertexbuffer {
-    Vertex *data;
+    VertexStreams streams;
     uint32 count, max_count;
 };
 
@@ -24,10 +60,35 @@ struct Indexbuffer {
 };
 
 struct Mesh {
-    Vertex *v_buffer;
+    VertexStreams vertices;
     uint32 *i;
     v2 por;
     uint32 index_count;
+    uint32 first_vertex, vertex_count; // The part of the streams the indices use
+    BoundingBox bounds; // Object space, for culling
+};
+
+/* Meshes of concave polygon shapes, which the half-plane fill of shapes
+ * cannot draw, so that they go through the triangle pipeline.
+ *
+ * There is one entry per shape of a ShapeList, found by the shape's index and
+ * triangulated on first use. The meshes only have positions, the color comes
+ * with the draw call.
+ *
+ * Outlines are not watched: one edited in place keeps its old mesh. An entry
+ * only notices a different outline array or vertex count, like when a new
+ * shape takes the index of an old one.
+ */
+struct ShapeMesh {
+    const v2 *outline; // 0 for an empty entry
+    uint32 count;
+    Mesh mesh;
+};
+
+struct ShapeMeshCache {
+    Vertexbuffer vb;
+    Indexbuffer ib;
+    ShapeMesh entries[MAX_SHAPE_COUNT]; // By shape index
 };
 
 struct Transform {
@@ -36,12 +97,75 @@ struct Transform {
     real32 rot;
 };
 
+// Buffer for 'max_count' vertices with the streams 'layout' asks for.
+Vertexbuffer
+create_vertexbuffer(AppMemory *mem, uint32 max_count, uint32 layout);
+
+inline uint32
+pack_vertex_color(v4 c) {
+    uint32 a = (uint32)(min(max(c.a, 0.0f), 1.0f) * 255 + 0.5f);
+    uint32 r = (uint32)(min(max(c.r, 0.0f), 1.0f) * 255 + 0.5f);
+    uint32 g = (uint32)(min(max(c.g, 0.0f), 1.0f) * 255 + 0.5f);
+    uint32 b = (uint32)(min(max(c.b, 0.0f), 1.0f) * 255 + 0.5f);
+    return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+// Coordinates out of range would be clamped and smear the edge texels, so
+// they are not allowed.
+inline PackedTexCoord
+pack_tex_coord(v2 uv) {
+    static constexpr real32 limit = 65535.0f / TEX_COORD_ONE;
+    assert(uv.x >= 0 && uv.x <= limit && uv.y >= 0 && uv.y <= limit);
+    PackedTexCoord result;
+    result.u = (uint16)(uv.x * TEX_COORD_ONE + 0.5f);
+    result.v = (uint16)(uv.y * TEX_COORD_ONE + 0.5f);
+    return result;
+}
+
+inline v4
+vertex_color(const VertexStreams &v, uint32 i) {
+    if (!v.colors)
+        return {1, 1, 1, 1};
+    uint32 c = v.colors[i];
+    static constexpr real32 scale = 1.0f / 255;
+    return {((c >> 16) & 0xFF) * scale, ((c >> 8) & 0xFF) * scale, (c & 0xFF) * scale, (c >> 24) * scale};
+}
+
+inline v2
+vertex_tex_coord(const VertexStreams &v, uint32 i) {
+    if (!v.tex_coords)
+        return {0, 0};
+    static constexpr real32 scale = 1.0f / TEX_COORD_ONE;
+    return {v.tex_coords[i].u * scale, v.tex_coords[i].v * scale};
+}
+
+// Append the vertices and indices to the buffers. Indices count from the
+// first of 'verts'. Attributes the vertex buffer has no stream for are
+// dropped.
 Mesh
 create_polygon(Vertexbuffer *vb, Indexbuffer *ib, const Vertex *verts, uint32 count_v, const uint32 *indices, uint32 count_i);
 
 Mesh
 create_rectangle(Vertexbuffer *vb, Indexbuffer *ib, v2 min, v2 max, v4 color);
 
+/* Split a simple polygon of either winding into triangles and write their
+ * indices into 'vertices' to 'indices', 3 * (count - 2) at most. Returns the
+ * number of indices.
+ *
+ * Convex outlines become a fan. Others are ear clipped, which takes
+ * O(count^2) and is meant for outlines of a few dozen vertices.
+ */
+uint32
+triangulate_polygon(const v2 *vertices, uint32 count, uint32 *indices);
+
+ShapeMeshCache *
+shape_mesh_cache_create(AppMemory *mem, uint32 max_vertices, uint32 max_indices);
+
+// Cached mesh of 'shape', the one at 'index' of its list. 0 for shapes that
+// are not concave polygons and if the cache is full.
+const ShapeMesh *
+shape_mesh_get(ShapeMeshCache *cache, const Shape &shape, uint32 index);
+
 v2
 center_of_mass(Mesh mesh);
 
@@ -52,10 +176,10 @@ area_squared(Mesh mesh) {
     real32 y_min = FLT_MAX;
     real32 y_max = -FLT_MAX;
     for (uint32 i = 0; i < mesh.index_count; i++) {
-        x_min = min(x_min, mesh.v_buffer[i].coord.x);
-        x_max = max(x_max, mesh.v_buffer[i].coord.x);
-        y_min = min(y_min, mesh.v_buffer[i].coord.y);
-        y_max = max(y_max, mesh.v_buffer[i].coord.y);
+        x_min = min(x_min, mesh.vertices.positions[i].x);
+        x_max = max(x_max, mesh.vertices.positions[i].x);
+        y_min = min(y_min, mesh.vertices.positions[i].y);
+        y_max = max(y_max, mesh.vertices.positions[i].y);
     }
     return (x_max - x_min) * (x_max - x_min) + (y_max - y_min) * (y_max - y_min);
 }
@@ -63,6 +187,10 @@ area_squared(Mesh mesh) {
 v2
 transform(v2 v, Transform t);
 
+// World space box around the transformed object space box 'b'.
+BoundingBox
+transform_bounds(BoundingBox b, Transform t);
+
 v2
 world_to_object_space(v2 v, Transform t);
 
@@ -14,9 +14,17 @@ get_points_on_axis_sweeping(Mesh mesh, v2 axis, Transform t, Transform sweep_off
 static void
 get_points_on_axis(Mesh mesh, v2 axis, Transform t, AxisProjections *out);
 
+struct IntegrateStep {
+    BodyList *list;
+    real64 d_t;
+};
+
+static void
+integrate_bodies(void *data, uint32 begin, uint32 end);
+
 uint32
 physics_create_body(BodyList *list, BodyDef def) {
-    Body body;
+    Body body = {};
     body.p = def.p;
     body.v = def.v;
     body.p_ang = def.p_ang;
@@ -34,6 +42,44 @@ physics_create_body(BodyList *list, BodyDef def) {
     return list->count++;
 }
 
+void
+physics_integrate(BodyList *list, real64 d_t, JobSystem *jobs) {
+    IntegrateStep step = {list, d_t};
+    job_parallel_for(jobs, list->count, integrate_bodies, &step);
+}
+
+BoundingBox
+physics_get_body_bounds(Body *body) {
+    if (body->bounds_valid && body->bounds_p.x == body->p.x && body->bounds_p.y == body->p.y && body->bounds_ang == body->p_ang)
+        return body->bounds;
+    BoundingBox b = {
+        {FLT_MAX, FLT_MAX},
+        {-FLT_MAX, -FLT_MAX}
+    };
+    for (uint32 i = 0; i < body->shape_count; i++) {
+        BoundingBox s = shape_get_bounding_box(*body->shapes[i], body->p_ang);
+        b.min.x = min(b.min.x, s.min.x + body->p.x);
+        b.min.y = min(b.min.y, s.min.y + body->p.y);
+        b.max.x = max(b.max.x, s.max.x + body->p.x);
+        b.max.y = max(b.max.y, s.max.y + body->p.y);
+    }
+    body->bounds = b;
+    body->bounds_p = body->p;
+    body->bounds_ang = body->p_ang;
+    body->bounds_valid = true;
+    return b;
+}
+
+static void
+integrate_bodies(void *data, uint32 begin, uint32 end) {
+    IntegrateStep *step = (IntegrateStep *)data;
+    for (uint32 i = begin; i < end; i++) {
+        Body *b = &step->list->bodies[i];
+        b->p += b->v * step->d_t;
+        b->p_ang += b->v_ang * step->d_t;
+    }
+}
+
 #if NEW_PHYSICS_SYSTEM
 void
 check_collision(Collision *collision, Body a, Body b, real64 dt, bool sweep) {
@@ -49,13 +95,13 @@ check_collision(Collision *collision, Mesh a, Mesh b, Transform t_a, Transform t
 
     // Get line normals scene axes
     for (uint32 i = 0; i < a.index_count - 1; i++) {
-        normals[i] = lnormal(transform(a.v_buffer[a.i[i]].coord, t_a), transform(a.v_buffer[a.i[i + 1]].coord, t_a));
+        normals[i] = lnormal(transform(a.vertices.positions[a.i[i]], t_a), transform(a.vertices.positions[a.i[i + 1]], t_a));
     }
-    normals[a.index_count - 1] = lnormal(transform(a.v_buffer[a.i[a.index_count - 1]].coord, t_a), transform(a.v_buffer[a.i[0]].coord, t_a));
+    normals[a.index_count - 1] = lnormal(transform(a.vertices.positions[a.i[a.index_count - 1]], t_a), transform(a.vertices.positions[a.i[0]], t_a));
     for (uint32 i = 0; i < b.index_count - 1; i++) {
-        normals[i + a.index_count] = lnormal(transform(b.v_buffer[b.i[i]].coord, t_b), transform(b.v_buffer[b.i[i + 1]].coord, t_b));
+        normals[i + a.index_count] = lnormal(transform(b.vertices.positions[b.i[i]], t_b), transform(b.vertices.positions[b.i[i + 1]], t_b));
     }
-    normals[a.index_count + b.index_count - 1] = lnormal(transform(b.v_buffer[b.i[b.index_count - 1]].coord, t_b), transform(b.v_buffer[b.i[0]].coord, t_b));
+    normals[a.index_count + b.index_count - 1] = lnormal(transform(b.vertices.positions[b.i[b.index_count - 1]], t_b), transform(b.vertices.positions[b.i[0]], t_b));
 
     real32 min_overlap = FLT_MAX;
     v2 min_overlap_axis;
@@ -252,9 +298,9 @@ get_points_on_axis_sweeping(Mesh mesh, v2 axis, Transform t, Transform sweep_off
     out->min = FLT_MAX;
     out->max = -FLT_MAX;
     for (uint32 a_i = 0; a_i < mesh.index_count; a_i++) {
-        v2 v = transform(mesh.v_buffer[mesh.i[a_i]].coord, t);
+        v2 v = transform(mesh.vertices.positions[mesh.i[a_i]], t);
         real32 proj = dot(v, axis);
-        v2 v_ext = transform(mesh.v_buffer[mesh.i[a_i]].coord, sweep_offset);
+        v2 v_ext = transform(mesh.vertices.positions[mesh.i[a_i]], sweep_offset);
         real32 proj_ext = dot(v_ext, axis);
         if (proj < out->min) {
             if (proj_ext < proj) {
@@ -298,7 +344,7 @@ get_points_on_axis(Mesh mesh, v2 axis, Transform t, AxisProjections *out) {
     out->min = FLT_MAX;
     out->max = -FLT_MAX;
     for (uint32 a_i = 0; a_i < mesh.index_count; a_i++) {
-        v2 v = transform(mesh.v_buffer[mesh.i[a_i]].coord, t);
+        v2 v = transform(mesh.vertices.positions[mesh.i[a_i]], t);
         real32 proj = dot(v, axis);
         if (proj < out->min) {
             out->min = proj;
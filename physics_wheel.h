@@ -8,6 +8,7 @@
 
 #define NEW_PHYSICS_SYSTEM 1
 
+#include "job_wheel.h"
 #include "shape_wheel.h"
 #include "mesh_wheel.h"
 
@@ -51,6 +52,11 @@ struct Body {
     real32 inertia_inv;
     real32 m;
     real32 m_inv;
+    // World space bounds of all shapes, valid for bounds_p and bounds_ang.
+    BoundingBox bounds;
+    v2 bounds_p;
+    real32 bounds_ang;
+    bool bounds_valid;
 };
 
 struct BodyList {
@@ -108,12 +114,21 @@ struct Movement {
 uint32
 physics_create_body(BodyList *list, BodyDef def);
 
+// Advance positions and angles of all bodies, one job per body.
+void
+physics_integrate(BodyList *list, real64 d_t, JobSystem *jobs);
+
 inline void
 physics_link_shape_to_body(Body *body, Shape *shape) {
     assert(body->shape_count < MAX_SHAPES_PER_BODY);
     body->shapes[body->shape_count++] = shape;
+    body->bounds_valid = false;
 }
 
+// World space bounds of the body, only recomputed after it moved.
+BoundingBox
+physics_get_body_bounds(Body *body);
+
 void
 handle_collisions(real64 d_t);
 
@@ -0,0 +1,333 @@
+#ifndef PIXEL_WHEEL_H
+
+// NOTE: Intrinsics headers pull in stdlib.h, so they have to come before
+// math_wheel.h defines its min/max/abs macros.
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "types_wheel.h"
+
+/* Packed 8-bit pixel operations.
+ *
+ * Pixels are 0xAARRGGBB. Blending works on premultiplied alpha, i.e. the
+ * color channels are already scaled by alpha, so 'src over dst' is
+ * src + dst * (255 - src.a) / 255 for every channel and needs no divide.
+ */
+
+inline uint32
+div255(uint32 x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+inline uint32
+premultiply_pixel(uint32 p) {
+    uint32 a = p >> 24;
+    uint32 r = div255(((p >> 16) & 0xFF) * a);
+    uint32 g = div255(((p >> 8) & 0xFF) * a);
+    uint32 b = div255((p & 0xFF) * a);
+    return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+// Channel-wise product of two pixels, e.g. to tint a premultiplied texel.
+inline uint32
+modulate_pixel(uint32 p, uint32 q) {
+    uint32 a = div255((p >> 24) * (q >> 24));
+    uint32 r = div255(((p >> 16) & 0xFF) * ((q >> 16) & 0xFF));
+    uint32 g = div255(((p >> 8) & 0xFF) * ((q >> 8) & 0xFF));
+    uint32 b = div255((p & 0xFF) * (q & 0xFF));
+    return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+// Two channels per multiply: red/blue and alpha/green sit in separate 16-bit
+// lanes, which cannot overflow since 255 * 255 + 255 < 65536.
+inline uint32
+blend_pixel_premultiplied(uint32 dst, uint32 src) {
+    uint32 inv = 255 - (src >> 24);
+    uint32 rb = (dst & 0x00FF00FF) * inv + 0x00800080;
+    rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+    uint32 ag = ((dst >> 8) & 0x00FF00FF) * inv + 0x00800080;
+    ag = (ag + ((ag >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+    return src + rb + ag;
+}
+
+// All four channels of a premultiplied pixel times coverage / 255, with the
+// same two lanes per multiply as the blend.
+inline uint32
+scale_pixel(uint32 p, uint32 coverage) {
+    uint32 rb = (p & 0x00FF00FF) * coverage + 0x00800080;
+    rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+    uint32 ag = ((p >> 8) & 0x00FF00FF) * coverage + 0x00800080;
+    ag = (ag + ((ag >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+    return rb | ag;
+}
+
+// a + (b - a) * t / 256 for every channel, t in [0, 256].
+inline uint32
+lerp_pixel(uint32 a, uint32 b, uint32 t) {
+    uint32 rb = a & 0x00FF00FF;
+    uint32 ag = (a >> 8) & 0x00FF00FF;
+    rb = (rb + ((((b & 0x00FF00FF) - rb) * t) >> 8)) & 0x00FF00FF;
+    ag = (ag + (((((b >> 8) & 0x00FF00FF) - ag) * t) >> 8)) & 0x00FF00FF;
+    return rb | (ag << 8);
+}
+
+// Rounded mean of four pixels, per channel.
+inline uint32
+average_pixels(uint32 a, uint32 b, uint32 c, uint32 d) {
+    uint32 rb = (a & 0x00FF00FF) + (b & 0x00FF00FF) + (c & 0x00FF00FF) + (d & 0x00FF00FF) + 0x00020002;
+    uint32 ag = ((a >> 8) & 0x00FF00FF) + ((b >> 8) & 0x00FF00FF) + ((c >> 8) & 0x00FF00FF) + ((d >> 8) & 0x00FF00FF) + 0x00020002;
+    return ((rb >> 2) & 0x00FF00FF) | ((ag << 6) & 0xFF00FF00);
+}
+
+#if defined(__SSE2__)
+// Blend four premultiplied pixels at once, working on 16-bit channels.
+inline __m128i
+blend4_premultiplied(__m128i dst, __m128i src) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c128 = _mm_set1_epi16(128);
+    const __m128i c255 = _mm_set1_epi16(255);
+    __m128i src_lo = _mm_unpacklo_epi8(src, zero);
+    __m128i src_hi = _mm_unpackhi_epi8(src, zero);
+    __m128i inv_lo = _mm_sub_epi16(c255, _mm_shufflehi_epi16(_mm_shufflelo_epi16(src_lo, 0xFF), 0xFF));
+    __m128i inv_hi = _mm_sub_epi16(c255, _mm_shufflehi_epi16(_mm_shufflelo_epi16(src_hi, 0xFF), 0xFF));
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(dst, zero), inv_lo), c128);
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(dst, zero), inv_hi), c128);
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+    return _mm_packus_epi16(_mm_add_epi16(lo, src_lo), _mm_add_epi16(hi, src_hi));
+}
+
+// modulate_pixel for four pixels.
+inline __m128i
+modulate4(__m128i p, __m128i q) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c128 = _mm_set1_epi16(128);
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(p, zero), _mm_unpacklo_epi8(q, zero)), c128);
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(p, zero), _mm_unpackhi_epi8(q, zero)), c128);
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+    return _mm_packus_epi16(lo, hi);
+}
+#endif
+
+// dst[i] = src[i] over dst[i]
+inline void
+blend_span_premultiplied(uint32 *dst, const uint32 *src, uint32 count) {
+    uint32 i = 0;
+#if defined(__SSE2__)
+    const __m128i alpha_mask = _mm_set1_epi32(0xFF000000);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        // Fully opaque and fully transparent runs are common in sprites and
+        // glyphs and need no arithmetic.
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, alpha_mask), alpha_mask)) == 0xFFFF) {
+            _mm_storeu_si128((__m128i *)(dst + i), s);
+        }
+        else if (_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) != 0xFFFF) {
+            __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+            _mm_storeu_si128((__m128i *)(dst + i), blend4_premultiplied(d, s));
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = blend_pixel_premultiplied(dst[i], src[i]);
+    }
+}
+
+// dst[i] = src over dst[i]
+inline void
+blend_span_solid_premultiplied(uint32 *dst, uint32 src, uint32 count) {
+    uint32 i = 0;
+#if defined(__SSE2__)
+    const __m128i s = _mm_set1_epi32(src);
+    for (; i + 4 <= count; i += 4) {
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+        _mm_storeu_si128((__m128i *)(dst + i), blend4_premultiplied(d, s));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = blend_pixel_premultiplied(dst[i], src);
+    }
+}
+
+// dst[i] = (src[i] * coverage[i] / 255) over dst[i], e.g. for anti-aliased
+// edges.
+inline void
+blend_span_coverage(uint32 *dst, const uint32 *src, const uint32 *coverage, uint32 count) {
+    uint32 i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c128 = _mm_set1_epi16(128);
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        // Spread each pixel's coverage over its four 16-bit channels.
+        __m128i c = _mm_loadu_si128((const __m128i *)(coverage + i));
+        c = _mm_packs_epi32(c, c);
+        c = _mm_unpacklo_epi16(c, c);
+        __m128i c_lo = _mm_unpacklo_epi32(c, c);
+        __m128i c_hi = _mm_unpackhi_epi32(c, c);
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), c_lo), c128);
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), c_hi), c128);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+        _mm_storeu_si128((__m128i *)(dst + i), blend4_premultiplied(d, _mm_packus_epi16(lo, hi)));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = blend_pixel_premultiplied(dst[i], scale_pixel(src[i], coverage[i]));
+    }
+}
+
+// dst[i] = src[i] * tint
+inline void
+modulate_span(uint32 *dst, const uint32 *src, uint32 count, uint32 tint) {
+    uint32 i = 0;
+#if defined(__SSE2__)
+    const __m128i t = _mm_set1_epi32(tint);
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), modulate4(s, t));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = modulate_pixel(src[i], tint);
+    }
+}
+
+// dst[i] = (src[i] * tint) over dst[i]
+inline void
+blend_span_tinted(uint32 *dst, const uint32 *src, uint32 count, uint32 tint) {
+    uint32 i = 0;
+#if defined(__SSE2__)
+    const __m128i t = _mm_set1_epi32(tint);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        // Transparent texels stay transparent, however they are tinted.
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) == 0xFFFF)
+            continue;
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+        _mm_storeu_si128((__m128i *)(dst + i), blend4_premultiplied(d, modulate4(s, t)));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = blend_pixel_premultiplied(dst[i], modulate_pixel(src[i], tint));
+    }
+}
+
+// dst[i] = src[i] * tint where src[i] is not the color key.
+inline void
+copy_span_color_key(uint32 *dst, const uint32 *src, uint32 count, uint32 key, uint32 tint) {
+    uint32 i = 0;
+#if defined(__SSE2__)
+    const __m128i k = _mm_set1_epi32(key);
+    const __m128i t = _mm_set1_epi32(tint);
+    bool tinted = tint != 0xFFFFFFFF;
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i m = _mm_cmpeq_epi32(s, k);
+        int32 keyed = _mm_movemask_epi8(m);
+        if (keyed == 0xFFFF)
+            continue;
+        if (tinted)
+            s = modulate4(s, t);
+        if (keyed) {
+            __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+            s = _mm_or_si128(_mm_and_si128(m, d), _mm_andnot_si128(m, s));
+        }
+        _mm_storeu_si128((__m128i *)(dst + i), s);
+    }
+#endif
+    for (; i < count; i++) {
+        if (src[i] != key)
+            dst[i] = modulate_pixel(src[i], tint);
+    }
+}
+
+// dst[i] = src over dst[i] where bit i of 'mask' is set, count <= 32. Each
+// group of four bits becomes a lane mask, so glyph rows need no per-pixel
+// branches.
+inline void
+blend_span_masked(uint32 *dst, uint32 mask, uint32 count, uint32 src) {
+    bool opaque = (src >> 24) == 0xFF;
+    uint32 i = 0;
+#if defined(__SSE2__)
+    const __m128i s = _mm_set1_epi32(src);
+    const __m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+    for (; i + 4 <= count; i += 4) {
+        uint32 nibble = (mask >> i) & 0xF;
+        if (!nibble)
+            continue;
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i m = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(nibble), lanes), lanes);
+        __m128i p = opaque ? s : blend4_premultiplied(d, s);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(_mm_and_si128(m, p), _mm_andnot_si128(m, d)));
+    }
+#endif
+    for (; i < count; i++) {
+        if ((mask >> i) & 1)
+            dst[i] = opaque ? src : blend_pixel_premultiplied(dst[i], src);
+    }
+}
+
+inline void
+premultiply_span(uint32 *p, uint32 count) {
+    for (uint32 i = 0; i < count; i++) {
+        p[i] = premultiply_pixel(p[i]);
+    }
+}
+
+// Color channels as 0bRRRRRGGGGGGBBBBB, alpha is dropped.
+inline uint16
+pixel_to_rgb565(uint32 p) {
+    return (uint16)(((p >> 8) & 0xF800) | ((p >> 5) & 0x07E0) | ((p >> 3) & 0x001F));
+}
+
+// Color channels with 4 bits each as 0xRGB, e.g. to index a palette lookup.
+inline uint32
+pixel_to_rgb444(uint32 p) {
+    return ((p >> 12) & 0xF00) | ((p >> 8) & 0x0F0) | ((p >> 4) & 0x00F);
+}
+
+inline void
+convert_span_rgb565(uint16 *dst, const uint32 *src, uint32 count) {
+    uint32 i = 0;
+#if defined(__SSE2__)
+    const __m128i red = _mm_set1_epi32(0xF800);
+    const __m128i green = _mm_set1_epi32(0x07E0);
+    const __m128i blue = _mm_set1_epi32(0x001F);
+    // The pack saturates signed values, so the lanes are moved into its range
+    // and back.
+    const __m128i bias32 = _mm_set1_epi32(0x8000);
+    const __m128i bias16 = _mm_set1_epi16((int16)0x8000);
+    for (; i + 8 <= count; i += 8) {
+        __m128i p[2];
+        for (uint32 j = 0; j < 2; j++) {
+            __m128i s = _mm_loadu_si128((const __m128i *)(src + i + 4 * j));
+            __m128i r = _mm_and_si128(_mm_srli_epi32(s, 8), red);
+            __m128i g = _mm_and_si128(_mm_srli_epi32(s, 5), green);
+            __m128i b = _mm_and_si128(_mm_srli_epi32(s, 3), blue);
+            p[j] = _mm_sub_epi32(_mm_or_si128(_mm_or_si128(r, g), b), bias32);
+        }
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_add_epi16(_mm_packs_epi32(p[0], p[1]), bias16));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = pixel_to_rgb565(src[i]);
+    }
+}
+
+// dst[i] = lookup[rgb444 of src[i]]
+inline void
+convert_span_indexed8(uint8 *dst, const uint32 *src, uint32 count, const uint8 *lookup) {
+    for (uint32 i = 0; i < count; i++) {
+        dst[i] = lookup[pixel_to_rgb444(src[i])];
+    }
+}
+
+#define PIXEL_WHEEL_H
+#endif
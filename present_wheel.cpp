@@ -0,0 +1,66 @@
+#include <string.h>
+
+#include "present_wheel.h"
+
+void
+palette_create_default(Palette *palette) {
+    static constexpr uint32 levels_r = 6;
+    static constexpr uint32 levels_g = 7;
+    static constexpr uint32 levels_b = 6;
+    palette->count = 0;
+    for (uint32 r = 0; r < levels_r; r++) {
+        for (uint32 g = 0; g < levels_g; g++) {
+            for (uint32 b = 0; b < levels_b; b++) {
+                uint32 cr = r * 255 / (levels_r - 1);
+                uint32 cg = g * 255 / (levels_g - 1);
+                uint32 cb = b * 255 / (levels_b - 1);
+                palette->colors[palette->count++] = (cr << 16) | (cg << 8) | cb;
+            }
+        }
+    }
+    palette_update_lookup(palette);
+}
+
+// Every 4-bit level stands for the 8-bit value it expands to, 0x0 to 0x00
+// and 0xF to 0xFF.
+void
+palette_update_lookup(Palette *palette) {
+    for (uint32 i = 0; i < 4096; i++) {
+        int32 r = (int32)((i >> 8) & 0xF) * 17;
+        int32 g = (int32)((i >> 4) & 0xF) * 17;
+        int32 b = (int32)(i & 0xF) * 17;
+        uint32 best = 0;
+        int32 best_distance = 0x7FFFFFFF;
+        for (uint32 j = 0; j < palette->count; j++) {
+            uint32 c = palette->colors[j];
+            int32 dr = (int32)((c >> 16) & 0xFF) - r;
+            int32 dg = (int32)((c >> 8) & 0xFF) - g;
+            int32 db = (int32)(c & 0xFF) - b;
+            int32 distance = dr * dr + dg * dg + db * db;
+            if (distance < best_distance) {
+                best = j;
+                best_distance = distance;
+            }
+        }
+        palette->lookup[i] = (uint8)best;
+    }
+}
+
+void
+present_convert(Framebuffer fb, PixelFormat format, const Palette *palette, void *dst, uint32 pitch) {
+    for (int32 y = 0; y < fb.height; y++) {
+        const uint32 *src = fb.data + y * fb.width;
+        uint8 *row = (uint8 *)dst + y * pitch;
+        switch (format) {
+            case PIXEL_XRGB8888:
+                memcpy(row, src, fb.width * sizeof(uint32));
+                break;
+            case PIXEL_RGB565:
+                convert_span_rgb565((uint16 *)row, src, fb.width);
+                break;
+            case PIXEL_INDEXED8:
+                convert_span_indexed8(row, src, fb.width, palette->lookup);
+                break;
+        }
+    }
+}
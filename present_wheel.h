@@ -0,0 +1,57 @@
+#ifndef PRESENT_WHEEL_H
+
+#include "pixel_wheel.h"
+#include "wheel.h"
+
+/* Reduced-bandwidth presentation.
+ *
+ * The renderer always draws 32-bit premultiplied pixels, since blending and
+ * anti-aliasing need the full 8 bits per channel. Windows on a 16-bit or
+ * 8-bit visual get the finished frame converted once as it is copied into
+ * their image, which halves or quarters what has to reach the X server.
+ */
+enum PixelFormat {
+    PIXEL_XRGB8888,
+    PIXEL_RGB565,
+    PIXEL_INDEXED8
+};
+
+/* Colors of an 8-bit visual.
+ *
+ * 'lookup' maps every color with 4 bits per channel, see pixel_to_rgb444, to
+ * the nearest of the 'count' colors and has to be rebuilt with
+ * palette_update_lookup when they change.
+ */
+struct Palette {
+    uint32 colors[256]; // 0xRRGGBB
+    uint32 count;
+    uint8 lookup[4096];
+};
+
+inline uint32
+pixel_format_bytes(PixelFormat format) {
+    switch (format) {
+        case PIXEL_RGB565:
+            return 2;
+        case PIXEL_INDEXED8:
+            return 1;
+        default:
+            return 4;
+    }
+}
+
+// A 6x7x6 color cube, with one more level of green, which the eye resolves
+// best.
+void
+palette_create_default(Palette *palette);
+
+void
+palette_update_lookup(Palette *palette);
+
+// Convert all of 'fb' into rows of 'pitch' bytes at 'dst'. The palette is
+// only used for PIXEL_INDEXED8.
+void
+present_convert(Framebuffer fb, PixelFormat format, const Palette *palette, void *dst, uint32 pitch);
+
+#define PRESENT_WHEEL_H
+#endif
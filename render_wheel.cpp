@@ -1,6 +1,149 @@
 #include <stdio.h>
+#include <float.h>
 #include "render_wheel.h"
 
+enum ShadeMode {
+    SHADE_SOLID,
+    SHADE_GOURAUD,
+    SHADE_TEXTURED,
+    SHADE_COUNT
+};
+
+enum BlendMode {
+    BLEND_OPAQUE,
+    BLEND_ALPHA,
+    BLEND_COUNT
+};
+
+// Vertex attributes are stored as planes over screen space:
+// value(x, y) = value + (x - origin.x) * value_dx + (y - origin.y) * value_dy
+// so a span only needs its start value and the x gradient.
+struct TriangleSetup {
+    v2 pos[3]; // Sorted by y
+    v2 origin;
+    v4 color, color_dx, color_dy;
+    v2 uv, uv_dx, uv_dy;
+    Texture *texture;
+    const MipLevel *level; // Level to sample, 0 if the texture has no mips
+    uint32 solid_pixel; // Premultiplied
+};
+
+typedef void (*TrianglePipeline)(Framebuffer fb, const TriangleSetup *ts);
+
+// Texels that sample_texels reads, either the texture's own pixels or one of
+// its mip levels. Coordinates are clamped to [u_min, u_max] x [v_min, v_max].
+struct TexelSource {
+    const uint32 *pixels;
+    uint32 pitch; // Texels per row of 'pixels'
+    const MipLevel *level; // Used instead of 'pixels' if set
+    bool bilinear; // Only for levels
+    int32 u_min, v_min;
+    int32 u_max, v_max;
+};
+
+// Output of the vertex shader.
+struct ShadedVertex {
+    v2 pos; // Screen space
+    v4 color; // Premultiplied
+    v2 tex_coord;
+};
+
+#define AA_SUBROWS 4
+
+// Non-horizontal polygon edge, y0 < y1.
+struct CoverageEdge {
+    real32 y0, y1;
+    real32 x0; // x at y0
+    real32 dxdy;
+};
+
+// Coverage of one pixel row by a convex polygon, see coverage_row().
+struct CoverageRow {
+    real32 left[AA_SUBROWS], right[AA_SUBROWS]; // Covered interval of each sub-row
+    int32 outer_begin, outer_end; // Pixels with any coverage
+    int32 inner_begin, inner_end; // Fully covered pixels
+};
+
+// Payloads of binned draw calls, already in screen space.
+struct TriangleCommand {
+    TrianglePipeline pipeline;
+    TriangleSetup setup;
+};
+
+struct PolygonCommand {
+    v2 vertices[MAX_VERTICES_PER_SHAPE];
+    v2 normals[MAX_VERTICES_PER_SHAPE];
+    uint32 count;
+    v2 start, end;
+    uint32 pixel;
+};
+
+struct CapsuleCommand {
+    v2 a, b;
+    real32 radius;
+    uint32 pixel;
+};
+
+struct LineCommand {
+    v2 a, b;
+    uint32 pixel;
+};
+
+struct ClearCommand {
+    uint32 pixel;
+};
+
+struct BlitCommand {
+    Texture texture;
+    int32 x, y;
+    Blit blit;
+};
+
+struct SpriteCommand {
+    Texture texture;
+    v2 center;
+    v2 scale;
+    real32 angle;
+    Blit blit;
+};
+
+struct GlyphCommand {
+    Texture bitmap;
+    const uint8 *rows; // 1-bit mask, used instead of the bitmap if set
+    uint32 row_bytes;
+    uint32 src_x, src_y;
+    uint32 width, height;
+    int32 x, y;
+    uint32 tint; // Premultiplied
+};
+
+static TrianglePipeline
+select_pipeline(ShadeMode shade, bool translucent, bool antialias);
+
+static bool
+setup_triangle(TriangleSetup *ts, const v2 *pos, const v4 *color, const v2 *tex_coord);
+
+static void
+draw_indexed_triangles(Framebuffer fb, const ShadedVertex *vertices, uint32 vertex_count, const uint32 *indices, uint32 index_count, uint32 first_index, Texture *texture, v4 *color, bool antialias);
+
+static inline int32
+fixed_texel(real32 t);
+
+static inline uint32
+mip_row(const MipLevel *level, uint32 y);
+
+static inline uint32
+mip_column(uint32 x);
+
+static inline uint32
+mip_offset(const MipLevel *level, uint32 x, uint32 y);
+
+static uint32
+select_mip_level(const MipChain *mips, real32 step2);
+
+static inline void
+sample_texels(const TexelSource *src, uint32 *texels, int32 count, int32 *u, int32 *v, int32 du, int32 dv);
+
 static v4
 complement(v4 c);
 
@@ -8,38 +151,103 @@ static void
 debug_draw_point(Framebuffer fb, v2 p, real32 radius, v4 color);
 
 static void
-debug_draw_flat_top_triangle(Framebuffer fb, const v2 *p, v4 color);
+draw_triangle_wireframe(Framebuffer fb, v2 *p, v4 color, uint32 thickness);
+
+static ShadedVertex
+vertex_shader(v2 coord, v4 color, v2 tex_coord, const Camera &camera, Transform transform);
+
+static v2
+object_to_screen_space(v2 v, Camera c, v2 p, real32 ang);
+
+static int
+vertex_compare_pos_y(const void *a, const void *b);
 
 static void
-debug_draw_flat_bottom_triangle(Framebuffer fb, const v2 *p, v4 color);
+raster_line(Framebuffer fb, v2 a, v2 b, uint32 pixel);
 
 static void
-draw_triangle_wireframe(Framebuffer fb, v2 *p, v4 color, uint32 thickness);
+raster_capsule(Framebuffer fb, v2 a, v2 b, real32 radius, uint32 pixel);
 
 static void
-draw_flat_bottom_triangle(Framebuffer fb, v2 *pos, v4 *color, v2 *tex_coord, Texture *texture, v4 *solid_color);
+push_capsule(Framebuffer fb, v2 a, v2 b, real32 radius, uint32 pixel);
 
 static void
-draw_flat_top_triangle(Framebuffer fb, v2 *pos, v4 *color, v2 *tex_coord, Texture *texture, v4 *solid_color);
+fill_convex_polygon(Framebuffer fb, const v2 *p, uint32 count, v4 color);
 
 static void
-vertex_shader(Vertex v, Camera camera, Transform transform, v2 *screen_pos, v4 *color, v2 *tex_coord);
+draw_closed_polyline(Framebuffer fb, const v2 *p, uint32 count, v4 color, uint32 thickness);
 
-static v2
-object_to_screen_space(v2 v, Camera c, v2 p, real32 ang);
+static void
+raster_convex_polygon(Framebuffer fb, const v2 *vertices, const v2 *normals, uint32 count, v2 start, v2 end, uint32 pixel);
 
-static v4
-fragment_shader(v4 fg_color, v4 bg_color);
+static uint32
+coverage_edges(const v2 *p, uint32 count, CoverageEdge *edges);
 
-static int
-vertex_compare_pos_y(const void *a, const void *b);
+static bool
+coverage_row(const CoverageEdge *edges, uint32 count, int32 y, CoverageRow *cr);
+
+static void
+span_coverage(const CoverageRow *cr, int32 x, int32 count, uint32 *coverage);
+
+static void
+submit_triangle(Framebuffer fb, TrianglePipeline pipeline, const TriangleSetup *ts);
+
+static void
+fill_clip_rect(Framebuffer fb, uint32 pixel);
+
+static void
+fill_row(Framebuffer fb, int32 y, int32 x_begin, int32 x_end, uint32 pixel);
+
+static void
+execute_triangle(Framebuffer fb, const void *data);
+
+static void
+execute_polygon(Framebuffer fb, const void *data);
+
+static void
+execute_capsule(Framebuffer fb, const void *data);
+
+static void
+execute_line(Framebuffer fb, const void *data);
+
+static void
+execute_clear(Framebuffer fb, const void *data);
+
+static void
+execute_blit(Framebuffer fb, const void *data);
+
+static void
+execute_sprite(Framebuffer fb, const void *data);
+
+static void
+sprite_span(real32 a, real32 d, real32 inv_d, real32 size, real32 *begin, real32 *end);
+
+static void
+raster_glyph(Framebuffer fb, const GlyphCommand *glyph);
+
+static void
+execute_glyph(Framebuffer fb, const void *data);
 
 void
 renderer_draw_shape_to_buffer(Framebuffer fb, Camera c, Shape shape, v2 p, real32 p_ang) {
-    // TODO: This only draws polygons!
+    static constexpr uint32 pixel = SHAPE_PIXEL;
+    // Shapes are opaque. The front pass draws all of them but anti-aliased
+    // edges, which are left for the back pass.
+    if (fb.occlusion_pass == OCCLUSION_BACK && (shape.type == ST_CIRCLE || !fb.antialias))
+        return;
+    if (shape.type == ST_CIRCLE) {
+        v2 center = object_to_screen_space(shape.circle.center, c, p, p_ang);
+        push_capsule(fb, center, center, shape.circle.radius * c.scale, pixel);
+        return;
+    }
     BoundingBox b = shape_get_bounding_box(shape, p_ang);
     v2 start = object_to_screen_space(b.min, c, p, 0);
     v2 end = object_to_screen_space(b.max, c, p, 0);
+    if (fb.antialias) {
+        // Edge pixels reach half a pixel past the shape.
+        start -= v2{1, 1};
+        end += v2{1, 1};
+    }
     v2 vertices_screen[MAX_VERTICES_PER_SHAPE];
     v2 normals_screen[MAX_VERTICES_PER_SHAPE];
     assert(shape.polygon.count < MAX_VERTICES_PER_SHAPE);
@@ -48,55 +256,50 @@ renderer_draw_shape_to_buffer(Framebuffer fb, Camera c, Shape shape, v2 p, real3
         vertices_screen[i] = object_to_screen_space(shape.polygon.vertices[i], c, p, p_ang);
         normals_screen[i] = rotate(shape.polygon.normals[i], {0, 0}, p_ang);
     }
-    uint32 width = (uint32)(end.x - start.x);
-    uint32 height = (uint32)(end.y - start.y);
-    for (uint32 y = 0; y < height; y++) {
-        uint32 pixel_y = (uint32)start.y + y;
-        if (pixel_y >= c.height) {
-            continue;
-        }
-        if (pixel_y >= 0) {
-            for (uint32 x = 0; x < width; x++) {
-                uint32 pixel_x = (uint32)start.x + x;
-                if (pixel_x >= c.width) {
-                    continue;
-                }
-                if (pixel_x >= 0) {
-                    bool contains = true;
-                    uint32 v_index = 0;
-                    v2 point = {(real32) pixel_x, (real32) pixel_y};
-                    while (contains && v_index < shape.polygon.count) {
-                        real32 dot_product = dot(point - vertices_screen[v_index], normals_screen[v_index]);
-                        if (dot_product > 0) {
-                            contains = false;
-                        }
-                        v_index++;
-                    }
-                    if (contains) {
-                        fb.data[pixel_x + c.width * pixel_y] = 0xFF605854;
-                    }
-                }
-            }
+    if (fb.tiles) {
+        PolygonCommand *cmd = (PolygonCommand *)tile_push(fb, start, end, execute_polygon, sizeof(PolygonCommand));
+        if (cmd) {
+            memcpy(cmd->vertices, vertices_screen, shape.polygon.count * sizeof(v2));
+            memcpy(cmd->normals, normals_screen, shape.polygon.count * sizeof(v2));
+            cmd->count = shape.polygon.count;
+            cmd->start = start;
+            cmd->end = end;
+            cmd->pixel = pixel;
         }
+        return;
     }
+    raster_convex_polygon(fb, vertices_screen, normals_screen, shape.polygon.count, start, end, pixel);
 }
 
 void
 draw_string_to_texture(Texture *texture, const char *str, Font f, v4 color) {
     uint32 x_offset = 0;
     uint32 line_offset = 0;
+    // Font bitmaps are premultiplied, so the tint has to be as well.
+    uint32 tint = premultiply_pixel(color_to_pixel(color));
     while (*str) {
         if (*str == '\n') {
             line_offset++;
             x_offset = 0;
         }
+        else if (f.glyphs) {
+            const uint8 *rows = font_glyph_rows(f, *str);
+            for (uint32 y = 0; y < f.cheight; y++) {
+                uint32 bits = rows ? glyph_row_bits(rows + y * f.row_bytes, f.row_bytes) : 0;
+                uint32 *dst = texture->pixels + x_offset + (y + line_offset * f.cheight) * texture->width;
+                for (uint32 x = 0; x < f.cwidth; x++) {
+                    dst[x] = (bits >> x) & 1 ? tint : 0;
+                }
+            }
+            x_offset += f.cwidth;
+        }
         else {
             uint32 start_x = ((*str - f.ascii_offset) * f.cwidth) % f.bitmap.width;
             uint32 start_y = f.cheight * (((*str - f.ascii_offset) * f.cwidth) / f.bitmap.width);
             for (uint32 y = 0; y < f.cheight; y++) {
                 for (uint32 x = 0; x < f.cwidth; x++) {
-                    v4 col = hadamard(color,pixel_to_color(f.bitmap.pixels[start_x + x + (start_y + y) * f.bitmap.width]));
-                    texture->pixels[x + x_offset + (y + line_offset * f.cheight) * texture->width] = color_to_pixel(col);
+                    uint32 texel = f.bitmap.pixels[start_x + x + (start_y + y) * f.bitmap.width];
+                    texture->pixels[x + x_offset + (y + line_offset * f.cheight) * texture->width] = modulate_pixel(texel, tint);
                 }
             }
             x_offset += f.cwidth;
@@ -105,6 +308,66 @@ draw_string_to_texture(Texture *texture, const char *str, Font f, v4 color) {
     }
 }
 
+void
+draw_string(Framebuffer fb, const char *str, Font f, v4 color, int32 x, int32 y) {
+    GlyphCommand glyph = {};
+    glyph.bitmap = f.bitmap;
+    glyph.row_bytes = f.row_bytes;
+    glyph.width = f.cwidth;
+    glyph.height = f.cheight;
+    glyph.tint = premultiply_pixel(color_to_pixel(color));
+    int32 x_offset = 0;
+    int32 line_offset = 0;
+    for (; *str; str++) {
+        if (*str == '\n') {
+            line_offset++;
+            x_offset = 0;
+            continue;
+        }
+        glyph.x = x + x_offset;
+        glyph.y = y + line_offset * f.cheight;
+        x_offset += f.cwidth;
+        if (f.glyphs) {
+            glyph.rows = font_glyph_rows(f, *str);
+            if (!glyph.rows)
+                continue;
+        }
+        else {
+            glyph.src_x = ((*str - f.ascii_offset) * f.cwidth) % f.bitmap.width;
+            glyph.src_y = f.cheight * (((*str - f.ascii_offset) * f.cwidth) / f.bitmap.width);
+        }
+        if (fb.tiles) {
+            v2 min = {(real32)glyph.x, (real32)glyph.y};
+            v2 max = {(real32)(glyph.x + glyph.width - 1), (real32)(glyph.y + glyph.height - 1)};
+            GlyphCommand *cmd = (GlyphCommand *)tile_push(fb, min, max, execute_glyph, sizeof(GlyphCommand));
+            if (cmd)
+                *cmd = glyph;
+        }
+        else {
+            raster_glyph(fb, &glyph);
+        }
+    }
+}
+
+void
+text_size(const char *str, Font f, uint32 *width, uint32 *height) {
+    uint32 columns = 0;
+    uint32 lines = 1;
+    uint32 column = 0;
+    for (; *str; str++) {
+        if (*str == '\n') {
+            lines++;
+            column = 0;
+        }
+        else {
+            column++;
+            columns = max(columns, column);
+        }
+    }
+    *width = columns * f.cwidth;
+    *height = lines * f.cheight;
+}
+
 v2
 world_to_screen_space(v2 coord, const Camera &camera) {
     v2 offset = {camera.width / 2.0f, camera.height / 2.0f};
@@ -117,32 +380,331 @@ screen_to_world_space(v2 coord, const Camera &camera) {
     return (coord - offset) / camera.scale + camera.pos;
 }
 
+BoundingBox
+camera_world_bounds(const Camera &camera) {
+    v2 a = screen_to_world_space({0, 0}, camera);
+    v2 b = screen_to_world_space({(real32)camera.width, (real32)camera.height}, camera);
+    return {{min(a.x, b.x), min(a.y, b.y)}, {max(a.x, b.x), max(a.y, b.y)}};
+}
+
+static bool
+push_line(Framebuffer fb, v2 a, v2 b, uint32 pixel) {
+    if (!fb.tiles)
+        return false;
+    v2 min = {min(a.x, b.x), min(a.y, b.y)};
+    v2 max = {max(a.x, b.x), max(a.y, b.y)};
+    LineCommand *cmd = (LineCommand *)tile_push(fb, min, max, execute_line, sizeof(LineCommand));
+    if (cmd) {
+        cmd->a = a;
+        cmd->b = b;
+        cmd->pixel = pixel;
+    }
+    return true;
+}
+
+static bool
+push_blit(Framebuffer fb, Texture texture, int32 x, int32 y, const Blit &blit) {
+    if (!fb.tiles)
+        return false;
+    v2 min = {(real32)x, (real32)y};
+    v2 max = {(real32)(x + (int32)blit.width - 1), (real32)(y + (int32)blit.height - 1)};
+    BlitCommand *cmd = (BlitCommand *)tile_push(fb, min, max, execute_blit, sizeof(BlitCommand));
+    if (cmd) {
+        cmd->texture = texture;
+        cmd->x = x;
+        cmd->y = y;
+        cmd->blit = blit;
+    }
+    return true;
+}
+
 void
-debug_draw_texture(Texture texture, Framebuffer fb, uint32 startx, uint32 starty) {
-    for (uint32 y = 0; y < texture.height; y++) {
-        for (uint32 x = 0; x < texture.width; x++) {
-            fb.data[startx + x + (starty + y) * fb.width] = texture.pixels[x + y * texture.width];
+draw_texture(Framebuffer fb, Texture texture, int32 x, int32 y, const Blit &blit) {
+    if (push_blit(fb, texture, x, y, blit))
+        return;
+    // Keep the source rectangle inside the texture.
+    uint32 src_x = min(blit.src_x, texture.width);
+    uint32 src_y = min(blit.src_y, texture.height);
+    int32 width = (int32)min(blit.width, texture.width - src_x);
+    int32 height = (int32)min(blit.height, texture.height - src_y);
+    int32 y_begin = max(y, fb.clip_y0);
+    int32 y_end = min(y + height, fb.clip_y1);
+    int32 x_begin = max(x, fb.clip_x0);
+    int32 x_end = min(x + width, fb.clip_x1);
+    if (x_begin >= x_end)
+        return;
+    static constexpr int32 CHUNK = 64;
+    bool tinted = blit.tint != 0xFFFFFFFF;
+    // Tiled texels get gathered into a row of their own first.
+    const MipLevel *level = texture.mips ? &texture.mips->levels[0] : 0;
+    uint32 gathered[CHUNK];
+    for (int32 row = y_begin; row < y_end; row++) {
+        uint32 *dst = fb.data + row * fb.width;
+        uint32 v = src_y + row - y;
+        const uint32 *src_row = level ? level->texels + mip_row(level, v) : texture.pixels + src_x + v * texture.width;
+        SpanCursor c = span_cursor(fb, row, x_begin, x_end);
+        int32 span_begin, span_end;
+        while (span_next(&c, &span_begin, &span_end)) {
+            int32 step = level ? CHUNK : span_end - span_begin;
+            for (int32 begin = span_begin; begin < span_end; begin += step) {
+                uint32 count = min(span_end - begin, step);
+                const uint32 *src = gathered;
+                if (level) {
+                    uint32 u = src_x + begin - x;
+                    for (uint32 i = 0; i < count; i++) {
+                        gathered[i] = src_row[mip_column(u + i)];
+                    }
+                }
+                else {
+                    src = src_row + begin - x;
+                }
+                switch (blit.mode) {
+                    case BLIT_OPAQUE:
+                        if (tinted)
+                            modulate_span(dst + begin, src, count, blit.tint);
+                        else
+                            memcpy(dst + begin, src, count * sizeof(uint32));
+                        break;
+                    case BLIT_ALPHA:
+                        if (tinted)
+                            blend_span_tinted(dst + begin, src, count, blit.tint);
+                        else
+                            blend_span_premultiplied(dst + begin, src, count);
+                        break;
+                    case BLIT_COLOR_KEY:
+                        copy_span_color_key(dst + begin, src, count, blit.color_key, blit.tint);
+                        break;
+                }
+            }
         }
     }
 }
 
+void
+debug_draw_texture(Texture texture, Framebuffer fb, uint32 startx, uint32 starty) {
+    draw_texture(fb, texture, startx, starty, blit_texture(texture, BLIT_OPAQUE));
+}
+
 void
 debug_draw_texture_alpha(Texture texture, Framebuffer fb, uint32 startx, uint32 starty) {
-    for (uint32 y = 0; y < texture.height; y++) {
-        for (uint32 x = 0; x < texture.width; x++) {
-            uint32 *dest = fb.data + startx + x + (starty + y) * fb.width;
-            uint32 *source = texture.pixels + x + y * texture.width;
-            *dest = color_to_pixel(fragment_shader(pixel_to_color(*dest), pixel_to_color(*source)));
+    draw_texture(fb, texture, startx, starty, blit_texture(texture, BLIT_ALPHA));
+}
+
+BoundingBox
+sprite_bounds(v2 center, v2 scale, real32 angle, const Blit &blit) {
+    real32 c = cosf(angle);
+    real32 s = sinf(angle);
+    real32 hw = 0.5f * blit.width * scale.x;
+    real32 hh = 0.5f * blit.height * scale.y;
+    real32 ex = fabsf(c * hw) + fabsf(s * hh);
+    real32 ey = fabsf(s * hw) + fabsf(c * hh);
+    return {{center.x - ex, center.y - ey}, {center.x + ex, center.y + ey}};
+}
+
+static bool
+push_sprite(Framebuffer fb, Texture texture, v2 center, v2 scale, real32 angle, const Blit &blit) {
+    if (!fb.tiles)
+        return false;
+    BoundingBox b = sprite_bounds(center, scale, angle, blit);
+    SpriteCommand *cmd = (SpriteCommand *)tile_push(fb, b.min, b.max, execute_sprite, sizeof(SpriteCommand));
+    if (cmd) {
+        cmd->texture = texture;
+        cmd->center = center;
+        cmd->scale = scale;
+        cmd->angle = angle;
+        cmd->blit = blit;
+    }
+    return true;
+}
+
+/* Rows are walked in texel coordinates. Pixel x of a row samples the source
+ * rectangle at (u0 + x * du, v0 + x * dv), which is linear in x, so the pixels
+ * that land inside it form one span that is solved for directly. Across the
+ * span the coordinates are stepped in 16.16 fixed point, and the sampler
+ * clamps them to the rectangle, which absorbs rounding at the span ends.
+ */
+void
+draw_sprite(Framebuffer fb, Texture texture, v2 center, v2 scale, real32 angle, const Blit &blit) {
+    if (scale.x == 0 || scale.y == 0 || push_sprite(fb, texture, center, scale, angle, blit))
+        return;
+    uint32 src_x = min(blit.src_x, texture.width);
+    uint32 src_y = min(blit.src_y, texture.height);
+    uint32 width = min(blit.width, texture.width - src_x);
+    uint32 height = min(blit.height, texture.height - src_y);
+    if (!width || !height)
+        return;
+
+    // Color keys only match unfiltered texels of the texture itself, which
+    // are level 0 if there is a chain.
+    TexelSource src = {};
+    src.pixels = texture.pixels;
+    src.pitch = texture.width;
+    v2 level_scale = {1.0f, 1.0f};
+    real32 offset = 0.0f;
+    if (texture.mips && blit.mode == BLIT_COLOR_KEY) {
+        src.level = &texture.mips->levels[0];
+    }
+    else if (texture.mips) {
+        real32 step = 1.0f / min(fabsf(scale.x), fabsf(scale.y));
+        const MipLevel *level = &texture.mips->levels[select_mip_level(texture.mips, step * step)];
+        level_scale = {(real32)level->width / texture.width, (real32)level->height / texture.height};
+        src.level = level;
+        // Bilinear filtering starts at the texel whose center is to the left.
+        src.bilinear = texture.mips->bilinear;
+        if (src.bilinear)
+            offset = -0.5f;
+    }
+    src.u_min = (int32)(src_x * level_scale.x);
+    src.v_min = (int32)(src_y * level_scale.y);
+    src.u_max = max(src.u_min, (int32)ceilf((src_x + width) * level_scale.x) - 1);
+    src.v_max = max(src.v_min, (int32)ceilf((src_y + height) * level_scale.y) - 1);
+
+    // Texel coordinates relative to the source rectangle at pixel centers.
+    real32 c = cosf(angle);
+    real32 s = sinf(angle);
+    real32 du = c / scale.x;
+    real32 dv = -s / scale.y;
+    real32 inv_du = du != 0 ? 1.0f / du : 0.0f;
+    real32 inv_dv = dv != 0 ? 1.0f / dv : 0.0f;
+    real32 dx0 = 0.5f - center.x;
+    BoundingBox b = sprite_bounds(center, scale, angle, blit);
+    int32 y_begin = max((int32)ceilf(b.min.y - 0.5f), fb.clip_y0);
+    int32 y_end = min((int32)ceilf(b.max.y - 0.5f), fb.clip_y1);
+    int32 fixed_du = fixed_texel(du * level_scale.x);
+    int32 fixed_dv = fixed_texel(dv * level_scale.y);
+    bool tinted = blit.tint != 0xFFFFFFFF;
+
+    static constexpr int32 CHUNK = 64;
+    uint32 texels[CHUNK];
+    for (int32 row = y_begin; row < y_end; row++) {
+        real32 dy = row + 0.5f - center.y;
+        real32 u0 = (c * dx0 + s * dy) / scale.x + 0.5f * width;
+        real32 v0 = (-s * dx0 + c * dy) / scale.y + 0.5f * height;
+        real32 u_begin, u_end, v_begin, v_end;
+        sprite_span(u0, du, inv_du, (real32)width, &u_begin, &u_end);
+        sprite_span(v0, dv, inv_dv, (real32)height, &v_begin, &v_end);
+        int32 x_start = (int32)ceilf(max(u_begin, v_begin));
+        int32 x_begin = max(x_start, fb.clip_x0);
+        int32 x_end = min((int32)ceilf(min(u_end, v_end)), fb.clip_x1);
+        if (x_begin >= x_end)
+            continue;
+        // Spans step on from the start of the row, so clipping to tiles or
+        // occluders does not change the texels they hit.
+        int32 u_start = fixed_texel((u0 + x_start * du + src_x) * level_scale.x + offset);
+        int32 v_start = fixed_texel((v0 + x_start * dv + src_y) * level_scale.y + offset);
+        uint32 *dst = fb.data + row * fb.width;
+        SpanCursor cursor = span_cursor(fb, row, x_begin, x_end);
+        int32 begin, end;
+        while (span_next(&cursor, &begin, &end)) {
+            int32 u = (int32)(u_start + (int64)fixed_du * (begin - x_start));
+            int32 v = (int32)(v_start + (int64)fixed_dv * (begin - x_start));
+            for (int32 x = begin; x < end; x += CHUNK) {
+                int32 count = min(CHUNK, end - x);
+                sample_texels(&src, texels, count, &u, &v, fixed_du, fixed_dv);
+                switch (blit.mode) {
+                    case BLIT_OPAQUE:
+                        if (tinted)
+                            modulate_span(dst + x, texels, count, blit.tint);
+                        else
+                            memcpy(dst + x, texels, count * sizeof(uint32));
+                        break;
+                    case BLIT_ALPHA:
+                        if (tinted)
+                            blend_span_tinted(dst + x, texels, count, blit.tint);
+                        else
+                            blend_span_premultiplied(dst + x, texels, count);
+                        break;
+                    case BLIT_COLOR_KEY:
+                        copy_span_color_key(dst + x, texels, count, blit.color_key, blit.tint);
+                        break;
+                }
+            }
         }
     }
 }
 
+// Pixels [begin, end) of a row where a + x * d lies in [0, size), with
+// inv_d = 1 / d.
+static void
+sprite_span(real32 a, real32 d, real32 inv_d, real32 size, real32 *begin, real32 *end) {
+    if (d > 0) {
+        *begin = -a * inv_d;
+        *end = (size - a) * inv_d;
+    }
+    else if (d < 0) {
+        *begin = (size - a) * inv_d;
+        *end = -a * inv_d;
+    }
+    else if (a >= 0 && a < size) {
+        *begin = -1e9f;
+        *end = 1e9f;
+    }
+    else {
+        *begin = 0;
+        *end = 0;
+    }
+}
+
 void
 clear_framebuffer(Framebuffer fb, v4 color) {
     uint32 pixel = color_to_pixel(color);
-    for (int32 i = 0; i < fb.width * fb.height; i ++) {
-        fb.data[i] = pixel;
+    if (fb.tiles) {
+        v2 min = {(real32)fb.clip_x0, (real32)fb.clip_y0};
+        v2 max = {(real32)(fb.clip_x1 - 1), (real32)(fb.clip_y1 - 1)};
+        ClearCommand *cmd = (ClearCommand *)tile_push(fb, min, max, execute_clear, sizeof(ClearCommand));
+        if (cmd)
+            cmd->pixel = pixel;
+        return;
+    }
+    fill_clip_rect(fb, pixel);
+}
+
+void
+texture_create_mips(Texture *texture, AppMemory *mem, bool bilinear) {
+    MipChain *mips = (MipChain *)get_memory(mem, sizeof(MipChain));
+    memset(mips, 0, sizeof(*mips));
+    mips->bilinear = bilinear;
+    uint32 w = texture->width;
+    uint32 h = texture->height;
+    for (;;) {
+        MipLevel *level = &mips->levels[mips->level_count];
+        uint32 tile_size = 1 << MIP_TILE_SHIFT;
+        uint32 tiles_y = (h + tile_size - 1) >> MIP_TILE_SHIFT;
+        level->width = w;
+        level->height = h;
+        level->tiles_x = (w + tile_size - 1) >> MIP_TILE_SHIFT;
+        level->texels = (uint32 *)get_memory(mem, level->tiles_x * tiles_y * tile_size * tile_size * sizeof(uint32));
+        // Tiles on the right and bottom edge are filled up with edge texels.
+        for (uint32 y = 0; y < tiles_y * tile_size; y++) {
+            for (uint32 x = 0; x < level->tiles_x * tile_size; x++) {
+                uint32 sx = min(x, w - 1);
+                uint32 sy = min(y, h - 1);
+                uint32 texel;
+                if (!mips->level_count) {
+                    texel = texture->pixels[sx + sy * texture->width];
+                }
+                else {
+                    // Odd sizes drop the last row or column of the level above.
+                    const MipLevel *up = level - 1;
+                    uint32 x0 = min(2 * sx, up->width - 1);
+                    uint32 x1 = min(2 * sx + 1, up->width - 1);
+                    uint32 y0 = min(2 * sy, up->height - 1);
+                    uint32 y1 = min(2 * sy + 1, up->height - 1);
+                    texel = average_pixels(up->texels[mip_offset(up, x0, y0)], up->texels[mip_offset(up, x1, y0)],
+                                           up->texels[mip_offset(up, x0, y1)], up->texels[mip_offset(up, x1, y1)]);
+                }
+                level->texels[mip_offset(level, x, y)] = texel;
+            }
+        }
+        mips->level_count++;
+        if ((w == 1 && h == 1) || mips->level_count == MIP_MAX_LEVELS)
+            break;
+        w = max(w >> 1, 1u);
+        h = max(h >> 1, 1u);
     }
+    free_memory(mem, texture->pixels, texture->width * texture->height * sizeof(uint32));
+    texture->pixels = 0;
+    texture->mips = mips;
 }
 
 uint32
@@ -207,114 +769,70 @@ debug_draw_vector(Framebuffer fb, v2 v, v2 offset, v4 color) {
 
 void
 draw_triangle(Framebuffer fb, Vertex *v, Transform t, Camera c, Texture *texture, v4 *color) {
-    v2 pos[3];
-    v4 vcolor[3];
-    v2 tex_coord[3];
-    vertex_shader(v[0], c, t, &pos[0], &vcolor[0], &tex_coord[0]);
-    vertex_shader(v[1], c, t, &pos[1], &vcolor[1], &tex_coord[1]);
-    vertex_shader(v[2], c, t, &pos[2], &vcolor[2], &tex_coord[2]);
-    if (pos[0].y > pos[2].y) {
-        v2 temp_pos = pos[0];
-        v2 temp_tex_coord = tex_coord[0];
-        v4 temp_vcolor = vcolor[0];
-        pos[0] = pos[2];
-        tex_coord[0] = tex_coord[2];
-        vcolor[0] = vcolor[2];
-        pos[2] = temp_pos;
-        tex_coord[2] = temp_tex_coord;;
-        vcolor[2] = temp_vcolor;
-    }
-    if (pos[0].y > pos[1].y) {
-        v2 temp_pos = pos[0];
-        v2 temp_tex_coord = tex_coord[0];
-        v4 temp_vcolor = vcolor[0];
-        pos[0] = pos[1];
-        tex_coord[0] = tex_coord[1];
-        vcolor[0] = vcolor[1];
-        pos[1] = temp_pos;
-        tex_coord[1] = temp_tex_coord;;
-        vcolor[1] = temp_vcolor;
-    }
-    if (pos[1].y > pos[2].y) {
-        v2 temp_pos = pos[1];
-        v2 temp_tex_coord = tex_coord[1];
-        v4 temp_vcolor = vcolor[1];
-        pos[1] = pos[2];
-        tex_coord[1] = tex_coord[2];
-        vcolor[1] = vcolor[2];
-        pos[2] = temp_pos;
-        tex_coord[2] = temp_tex_coord;;
-        vcolor[2] = temp_vcolor;
-    }
-    if (round(pos[1].y) == round(pos[2].y)) {
-        draw_flat_bottom_triangle(fb, pos, vcolor, tex_coord, texture, color);
-    }
-    else if (round(pos[0].y) == round(pos[1].y)) {
-        draw_flat_top_triangle(fb, pos, vcolor, tex_coord, texture, color);
-    }
-    else {
-        v2 split = {pos[0].x + (pos[1].y - pos[0].y) * (pos[2].x - pos[0].x) / (pos[2].y - pos[0].y), pos[1].y};
-        real32 area2 = det(pos[0], pos[1], pos[2]);
-        real32 c0 = det(split, pos[1], pos[2]) / area2;
-        real32 c1 = det(split, pos[2], pos[0]) / area2;
-        real32 c2 = 1.0f - c0 - c1;
-        v4 split_vcolor = c0 * vcolor[0] + c1 * vcolor[1] + c2 * vcolor[2];
-        v2 split_tex_coord = c0 * tex_coord[0] + c1 * tex_coord[1] + c2 * tex_coord[2];
-        v2 temp_pos = pos[2];
-        v4 temp_vcolor = vcolor[2];
-        v2 temp_tex_coord = tex_coord[2];
-        pos[2] = split;
-        vcolor[2] = split_vcolor;
-        tex_coord[2] = split_tex_coord;
-        draw_flat_bottom_triangle(fb, pos, vcolor, tex_coord, texture, color);
-        pos[2] = temp_pos;
-        vcolor[2] = temp_vcolor;
-        tex_coord[2] = temp_tex_coord;
-        pos[0] = split;
-        vcolor[0] = split_vcolor;
-        tex_coord[0] = split_tex_coord;
-        draw_flat_top_triangle(fb, pos, vcolor, tex_coord, texture, color);
-    }
+    static const uint32 indices[3] = {0, 1, 2};
+    ShadedVertex shaded[3];
+    for (uint32 i = 0; i < 3; i++)
+        shaded[i] = vertex_shader(v[i].coord, v[i].color, v[i].tex_coord, c, t);
+    draw_indexed_triangles(fb, shaded, 3, indices, 3, 0, texture, color, fb.antialias);
 }
 
-
 void
 debug_draw_triangle(Framebuffer fb, v2 *p, v4 color) {
-    qsort(p, 3, sizeof(v2), v2_compare_y);
-    if (round(p[1].y) == round(p[2].y)) {
-        debug_draw_flat_bottom_triangle(fb, p, color);
-    }
-    else if (round(p[0].y) == round(p[1].y)) {
-        debug_draw_flat_top_triangle(fb, p, color);
-    }
-    else {
-        v2 split = {p[0].x + (p[1].y - p[0].y) * (p[2].x - p[0].x) / (p[2].y - p[0].y), p[1].y};
-        v2 tmp = p[2];
-        p[2] = split;
-        debug_draw_flat_bottom_triangle(fb, p, color);
-        p[2] = tmp;
-        p[0] = split;
-        debug_draw_flat_top_triangle(fb, p, color);
+    TriangleSetup ts = {};
+    ts.solid_pixel = premultiply_pixel(color_to_pixel(color));
+    v4 vcolor[3] = {color, color, color};
+    v2 tex_coord[3] = {};
+    if (setup_triangle(&ts, p, vcolor, tex_coord)) {
+        submit_triangle(fb, select_pipeline(SHADE_SOLID, color.a < 1.0f - EPSILON, fb.antialias), &ts);
     }
 }
 
 void
-draw_mesh(const Camera &camera, Framebuffer fb, Mesh mesh, Transform t, Texture *texture, v4 *color) {
-    for (uint32 i = 0; i < mesh.index_count; i += 3) {
-        Vertex tri[3];
-        tri[0] = mesh.v_buffer[mesh.i[i + 0]];
-        tri[1] = mesh.v_buffer[mesh.i[i + 1]];
-        tri[2] = mesh.v_buffer[mesh.i[i + 2]];
-        draw_triangle(fb, tri, t, camera, texture, color);
+draw_mesh(const Camera &camera, Framebuffer fb, Mesh mesh, Transform t, Texture *texture, v4 *color, MemoryArena *scratch) {
+    if (!bounding_box_overlap(transform_bounds(mesh.bounds, t), camera_world_bounds(camera)))
+        return;
+    // Anti-aliasing every triangle on its own would leave seams along the
+    // edges they share.
+    bool antialias = false;
+    // Triangles share most of their vertices, so every vertex of the mesh is
+    // shaded once and the triangles are assembled from the results. Without
+    // scratch space each triangle shades its own three.
+    uint64 mark = scratch ? scratch->used : 0;
+    ShadedVertex *shaded = 0;
+    if (scratch)
+        shaded = (ShadedVertex *)arena_push(scratch, mesh.vertex_count * sizeof(ShadedVertex));
+    if (shaded) {
+        const VertexStreams &v = mesh.vertices;
+        for (uint32 i = mesh.first_vertex; i < mesh.first_vertex + mesh.vertex_count; i++)
+            shaded[i - mesh.first_vertex] = vertex_shader(v.positions[i], vertex_color(v, i), vertex_tex_coord(v, i), camera, t);
+        draw_indexed_triangles(fb, shaded, mesh.vertex_count, mesh.i, mesh.index_count, mesh.first_vertex, texture, color, antialias);
+        arena_rewind(scratch, mark);
+        return;
+    }
+    static const uint32 indices[3] = {0, 1, 2};
+    for (uint32 i = 0; i + 2 < mesh.index_count; i += 3) {
+        ShadedVertex tri[3];
+        for (uint32 j = 0; j < 3; j++) {
+            uint32 k = mesh.i[i + j];
+            tri[j] = vertex_shader(mesh.vertices.positions[k], vertex_color(mesh.vertices, k), vertex_tex_coord(mesh.vertices, k), camera, t);
+        }
+        draw_indexed_triangles(fb, tri, 3, indices, 3, 0, texture, color, antialias);
     }
 }
 
 void
 draw_mesh_wireframe(const Camera &camera, Framebuffer fb, Mesh mesh, Transform t, v4 color, uint32 thickness) {
+    BoundingBox b = transform_bounds(mesh.bounds, t);
+    // Thick lines reach past the mesh.
+    real32 margin = thickness / camera.scale;
+    b.min -= v2{margin, margin};
+    b.max += v2{margin, margin};
+    if (!bounding_box_overlap(b, camera_world_bounds(camera)))
+        return;
     for (uint32 i = 0; i < mesh.index_count; i += 3) {
         v2 tri[3];
         for (int32 j = 0; j < 3; j++)
-            tri[j] = world_to_screen_space(transform(mesh.v_buffer[mesh.i[i + j]].coord, t), camera);
+            tri[j] = world_to_screen_space(transform(mesh.vertices.positions[mesh.i[i + j]], t), camera);
         draw_triangle_wireframe(fb, tri, color, thickness);
     }
 }
@@ -330,214 +848,1058 @@ complement(v4 c) {
 
 static void
 debug_draw_point(Framebuffer fb, v2 p, real32 radius, v4 color) {
-    uint32 pixel = color_to_pixel(color);
-    for (int32 y = max(0, p.y - radius); y <= min(fb.height - 1, p.y + radius); y++) {
-        for (int32 x = max(0, p.x - radius); x <= min(fb.width - 1, p.x + radius); x++) {
-            if (magnitude(v2{(real32)x, (real32)y} - p) <= radius)
-                fb.data[x + y * fb.width] = pixel;
-        }
-    }
+    push_capsule(fb, p, p, radius, color_to_pixel(color));
+}
+
+void
+draw_capsule(Framebuffer fb, v2 a, v2 b, real32 radius, v4 color) {
+    push_capsule(fb, a, b, radius, color_to_pixel(color));
 }
 
 void
 draw_line(Framebuffer fb, v2 a, v2 b, v4 color) {
-    real32 dx = a.x - b.x;
-    real32 dy = a.y - b.y;
-    real32 step = max(abs(dx), abs(dy));
-    dx /= step;
-    dy /= step;
-    real32 x = a.x;
-    real32 y = a.y;
-    int32 i = 1;
     uint32 pixel = color_to_pixel(color);
-    while (i++ <= step) {
-        if (x > 0 && y > 0 && x < fb.width && y < fb.height)
-            fb.data[(int)x + (int)y * fb.width] = pixel;
-        x -= dx;
-        y -= dy;
-    }
+    if (push_line(fb, a, b, pixel))
+        return;
+    raster_line(fb, a, b, pixel);
 }
 
 static void
 draw_triangle_wireframe(Framebuffer fb, v2 *p, v4 color, uint32 thickness) {
-    draw_line(fb, p[0], p[1], color, thickness);
-    draw_line(fb, p[1], p[2], color, thickness);
-    draw_line(fb, p[2], p[0], color, thickness);
+    draw_closed_polyline(fb, p, 3, color, thickness);
 }
 
+// Thick lines are a single quad through the triangle span filler, with
+// square ends that stop at 'a' and 'b'.
 void
 draw_line(Framebuffer fb, v2 a, v2 b, v4 color, uint32 thickness) {
     if (thickness < 1)
         return;
-    draw_line(fb, a, b, color);
-    if ((abs(a.x - b.x) > EPSILON) && (abs(b.y - a.y) < abs(b.x - a.x))) {
-        uint32 wy = (thickness-1)*sqrt(pow((b.x-a.x),2)+pow((b.y-a.y),2))/(2*fabs(b.x-a.x));
-        for (uint32 i = 1; i < wy; i++) {
-            draw_line(fb, {a.x, a.y - i}, {b.x, b.y - i}, color);
-            draw_line(fb, {a.x, a.y + i}, {b.x, b.y + i}, color);
+    if (thickness == 1) {
+        draw_line(fb, a, b, color);
+        return;
+    }
+    v2 d = b - a;
+    real32 length = magnitude(d);
+    if (length < EPSILON)
+        return;
+    v2 n = lnormal(d) * (0.5f * thickness / length);
+    v2 quad[4] = {a + n, b + n, b - n, a - n};
+    fill_convex_polygon(fb, quad, 4, color);
+}
+
+/* One pixel wide line from 'a' towards 'b', with 'b' itself left out.
+ *
+ * Pixel k is floor(a + k * (b - a) / n) for k in [0, n), where n is the
+ * length along the major axis. The major coordinate is an integer step and
+ * the minor one is stepped in 32.32 fixed point from the unclipped start, so
+ * the pixels do not depend on the clip rectangle. The range of k inside the
+ * clip rectangle is found once with Liang-Barsky instead of testing every
+ * pixel.
+ */
+static void
+raster_line(Framebuffer fb, v2 a, v2 b, uint32 pixel) {
+    static constexpr real32 LINE_LIMIT = (real32)(1 << 24);
+    if (!(abs(a.x) < LINE_LIMIT && abs(a.y) < LINE_LIMIT && abs(b.x) < LINE_LIMIT && abs(b.y) < LINE_LIMIT))
+        return;
+    v2 d = b - a;
+    bool x_major = abs(d.x) >= abs(d.y);
+    real32 steps = x_major ? abs(d.x) : abs(d.y);
+    if (steps < 1)
+        return;
+    int64 n = (int64)steps;
+
+    // Parameter range of the segment inside the clip rectangle
+    real32 t0 = 0;
+    real32 t1 = 1;
+    real32 p[4] = {-d.x, d.x, -d.y, d.y};
+    real32 q[4] = {a.x - fb.clip_x0, fb.clip_x1 - a.x, a.y - fb.clip_y0, fb.clip_y1 - a.y};
+    for (uint32 i = 0; i < 4; i++) {
+        if (p[i] == 0) {
+            if (q[i] < 0)
+                return;
+        }
+        else if (p[i] < 0) {
+            t0 = max(t0, q[i] / p[i]);
+        }
+        else {
+            t1 = min(t1, q[i] / p[i]);
+        }
+    }
+    if (t0 > t1)
+        return;
+
+    int32 major_lo = x_major ? fb.clip_x0 : fb.clip_y0;
+    int32 major_hi = x_major ? fb.clip_x1 : fb.clip_y1;
+    int32 minor_lo = x_major ? fb.clip_y0 : fb.clip_x0;
+    int32 minor_hi = x_major ? fb.clip_y1 : fb.clip_x1;
+    real32 major_start = x_major ? a.x : a.y;
+    real32 minor_start = x_major ? a.y : a.x;
+    real32 major_d = x_major ? d.x : d.y;
+    real32 minor_d = x_major ? d.y : d.x;
+    int64 major0 = (int64)floorf(major_start);
+    int64 major_step = major_d < 0 ? -1 : 1;
+    int64 minor0 = (int64)((double)minor_start * 4294967296.0);
+    int64 minor_step = (int64)((double)minor_d / steps * 4294967296.0);
+
+    // The float range may be off by a pixel at either end, so it is widened
+    // and then trimmed with the exact integer positions.
+    int64 k_begin = max((int64)floorf(t0 * steps) - 1, (int64)0);
+    int64 k_end = min((int64)ceilf(t1 * steps) + 2, n);
+    while (k_begin < k_end) {
+        int64 major = major0 + k_begin * major_step;
+        int64 minor = (minor0 + k_begin * minor_step) >> 32;
+        if (major >= major_lo && major < major_hi && minor >= minor_lo && minor < minor_hi)
+            break;
+        k_begin++;
+    }
+    while (k_end > k_begin) {
+        int64 major = major0 + (k_end - 1) * major_step;
+        int64 minor = (minor0 + (k_end - 1) * minor_step) >> 32;
+        if (major >= major_lo && major < major_hi && minor >= minor_lo && minor < minor_hi)
+            break;
+        k_end--;
+    }
+
+    int64 major = major0 + k_begin * major_step;
+    int64 minor = minor0 + k_begin * minor_step;
+    int64 major_stride = x_major ? 1 : fb.width;
+    int64 minor_stride = x_major ? fb.width : 1;
+    for (int64 k = k_begin; k < k_end; k++) {
+        fb.data[major * major_stride + (minor >> 32) * minor_stride] = pixel;
+        major += major_step;
+        minor += minor_step;
+    }
+}
+
+static void
+fill_convex_polygon(Framebuffer fb, const v2 *p, uint32 count, v4 color) {
+    TriangleSetup ts = {};
+    ts.solid_pixel = premultiply_pixel(color_to_pixel(color));
+    TrianglePipeline pipeline = select_pipeline(SHADE_SOLID, color.a < 1.0f - EPSILON, false);
+    v4 vcolor[3] = {color, color, color};
+    v2 tex_coord[3] = {};
+    // A fan shares its inner edges exactly, so no pixel is covered twice.
+    for (uint32 i = 1; i + 1 < count; i++) {
+        v2 tri[3] = {p[0], p[i], p[i + 1]};
+        if (setup_triangle(&ts, tri, vcolor, tex_coord))
+            submit_triangle(fb, pipeline, &ts);
+    }
+}
+
+/* Thick outline of a closed polygon with mitered corners.
+ *
+ * Neighbouring segments end on the same miter points, so the corners have
+ * neither gaps nor overlap. Corners sharper than the miter limit are beveled
+ * instead, there the segments overlap on the inside.
+ */
+static void
+draw_closed_polyline(Framebuffer fb, const v2 *p, uint32 count, v4 color, uint32 thickness) {
+    if (thickness <= 1) {
+        for (uint32 i = 0; i < count; i++)
+            draw_line(fb, p[i], p[(i + 1) % count], color, thickness);
+        return;
+    }
+    static constexpr uint32 MAX_POINTS = 16;
+    static constexpr real32 MITER_LIMIT = 4;
+    assert(count <= MAX_POINTS);
+    real32 hw = 0.5f * thickness;
+    // Left and right corners where the segment into a vertex ends and where
+    // the segment out of it starts
+    v2 in_l[MAX_POINTS], in_r[MAX_POINTS], out_l[MAX_POINTS], out_r[MAX_POINTS];
+    for (uint32 i = 0; i < count; i++) {
+        v2 prev = p[(i + count - 1) % count];
+        v2 next = p[(i + 1) % count];
+        v2 n0 = lnormal(normalize(p[i] - prev)) * hw;
+        v2 n1 = lnormal(normalize(next - p[i])) * hw;
+        v2 m = n0 + n1;
+        real32 m_sq = dot(m, m);
+        // |m| = 2 * hw * cos(a / 2) for the turning angle a and the miter is
+        // hw / cos(a / 2) long, so it scales m by 2 * hw^2 / |m|^2.
+        if (m_sq * MITER_LIMIT * MITER_LIMIT > 4 * hw * hw) {
+            v2 miter = m * (2 * hw * hw / m_sq);
+            in_l[i] = out_l[i] = p[i] + miter;
+            in_r[i] = out_r[i] = p[i] - miter;
+        }
+        else {
+            in_l[i] = p[i] + n0;
+            in_r[i] = p[i] - n0;
+            out_l[i] = p[i] + n1;
+            out_r[i] = p[i] - n1;
+            // Fill the wedge on the outside of the turn.
+            v2 d0 = p[i] - prev;
+            v2 d1 = next - p[i];
+            real32 turn = d0.x * d1.y - d0.y * d1.x;
+            v2 bevel[3] = {p[i], turn > 0 ? in_l[i] : in_r[i], turn > 0 ? out_l[i] : out_r[i]};
+            fill_convex_polygon(fb, bevel, 3, color);
+        }
+    }
+    for (uint32 i = 0; i < count; i++) {
+        uint32 j = (i + 1) % count;
+        v2 quad[4] = {out_l[i], in_l[j], in_r[j], out_r[i]};
+        fill_convex_polygon(fb, quad, 4, color);
+    }
+}
+
+static ShadedVertex
+vertex_shader(v2 coord, v4 color, v2 tex_coord, const Camera &cam, Transform t) {
+    ShadedVertex result;
+    result.pos = world_to_screen_space(transform(coord, t), cam);
+    // Premultiplied colors interpolate correctly across alpha changes.
+    result.color = {color.r * color.a, color.g * color.a, color.b * color.a, color.a};
+    result.tex_coord = tex_coord;
+    return result;
+}
+
+static int
+vertex_compare_pos_y(const void *a, const void *b) {
+    const v2 *va = (const v2 *)a;
+    const v2 *vb = (const v2 *)b;
+    if (va->y > vb->y)
+        return 1;
+    else if (va->y < vb->y)
+        return -1;
+    else
+        return 0;
+}
+
+static v2
+object_to_screen_space(v2 v, Camera c, v2 p, real32 ang) {
+    v2 result = rotate(v, {0, 0}, ang);
+    result += p; // Now we are in world space
+    result -= c.pos;
+    result *= c.scale;
+    v2 screen_center = 0.5 * v2{(real32)c.width, (real32)c.height};
+    result += screen_center;
+    return result;
+}
+
+struct FixedColor {
+    int32 r, g, b, a;
+};
+
+// 16.16 fixed point channels in [0, 255], rounding bias included.
+static FixedColor
+fixed_color(v4 c) {
+    static constexpr real32 scale = 255.0f * 65536.0f;
+    static constexpr real32 limit = 255.0f * 65536.0f + 32767.0f;
+    FixedColor f;
+    f.r = (int32)min(max(c.r * scale + 32768.0f, 0.0f), limit);
+    f.g = (int32)min(max(c.g * scale + 32768.0f, 0.0f), limit);
+    f.b = (int32)min(max(c.b * scale + 32768.0f, 0.0f), limit);
+    f.a = (int32)min(max(c.a * scale + 32768.0f, 0.0f), limit);
+    return f;
+}
+
+static inline uint32
+fixed_color_to_pixel(FixedColor c) {
+    return ((uint32)(c.a >> 16) << 24) | ((uint32)(c.r >> 16) << 16) | ((uint32)(c.g >> 16) << 8) | (uint32)(c.b >> 16);
+}
+
+// 16.16 fixed point texel coordinate. The float is clamped first so that
+// far-off extrapolation cannot overflow the conversion.
+static inline int32
+fixed_texel(real32 t) {
+    return (int32)(min(max(t, -32000.0f), 32000.0f) * 65536.0f);
+}
+
+// Tiles are stored row by row, and so are the texels within a tile. The
+// offset splits into a part for the row and one for the column, which lets
+// filters share the row part between texels.
+static inline uint32
+mip_row(const MipLevel *level, uint32 y) {
+    uint32 mask = (1 << MIP_TILE_SHIFT) - 1;
+    return ((y >> MIP_TILE_SHIFT) * level->tiles_x << (2 * MIP_TILE_SHIFT)) | ((y & mask) << MIP_TILE_SHIFT);
+}
+
+static inline uint32
+mip_column(uint32 x) {
+    uint32 mask = (1 << MIP_TILE_SHIFT) - 1;
+    return ((x >> MIP_TILE_SHIFT) << (2 * MIP_TILE_SHIFT)) | (x & mask);
+}
+
+static inline uint32
+mip_offset(const MipLevel *level, uint32 x, uint32 y) {
+    return mip_row(level, y) + mip_column(x);
+}
+
+// The level closest to a texel step of sqrt(step2) per pixel, rounded in
+// log2.
+static uint32
+select_mip_level(const MipChain *mips, real32 step2) {
+    uint32 l = 0;
+    for (real32 threshold = 2.0f; l + 1 < mips->level_count && step2 >= threshold; threshold *= 4.0f)
+        l++;
+    return l;
+}
+
+// Texel lookups of sample_texels, with or without clamping the coordinates.
+template <bool CLAMP>
+static inline void
+sample_texel_loop(const TexelSource *src, uint32 *texels, int32 count, int32 *u, int32 *v, int32 du, int32 dv) {
+    int32 su = *u;
+    int32 sv = *v;
+    int32 u_min = src->u_min;
+    int32 v_min = src->v_min;
+    int32 u_max = src->u_max;
+    int32 v_max = src->v_max;
+    if (!src->level) {
+        const uint32 *pixels = src->pixels;
+        uint32 pitch = src->pitch;
+        for (int32 i = 0; i < count; i++) {
+            int32 tu = su >> 16;
+            int32 tv = sv >> 16;
+            if (CLAMP) {
+                tu = min(max(tu, u_min), u_max);
+                tv = min(max(tv, v_min), v_max);
+            }
+            texels[i] = pixels[tu + tv * pitch];
+            su += du;
+            sv += dv;
+        }
+    }
+    else if (!src->bilinear) {
+        // A local copy of the level keeps stores to the chunk from forcing
+        // its fields to be reloaded for every texel.
+        MipLevel l = *src->level;
+        for (int32 i = 0; i < count; i++) {
+            int32 tu = su >> 16;
+            int32 tv = sv >> 16;
+            if (CLAMP) {
+                tu = min(max(tu, u_min), u_max);
+                tv = min(max(tv, v_min), v_max);
+            }
+            texels[i] = l.texels[mip_offset(&l, tu, tv)];
+            su += du;
+            sv += dv;
         }
     }
     else {
-        uint32 wx = (thickness-1)*sqrt(pow((b.x-a.x),2)+pow((b.y-a.y),2))/(2*fabs(b.y-a.y));
-        for (uint32 i = 1; i < wx; i++) {
-            draw_line(fb, {a.x - i, a.y}, {b.x - i, b.y}, color);
-            draw_line(fb, {a.x + i, a.y}, {b.x + i, b.y}, color);
-        }
-    }
-}
-
-static void
-debug_draw_flat_bottom_triangle(Framebuffer fb, const v2 *p, v4 color) {
-    //uint32 pixel = color_to_pixel(color);
-    assert(p[0].y < p[1].y && p[0].y < p[2].y);
-    assert(round(p[1].y) == round(p[2].y));
-    v2 p_l = p[1].x < p[2].x ? p[1] : p[2];
-    v2 p_r = p[1].x > p[2].x ? p[1] : p[2];
-    real32 dx_l = (p_l.x - p[0].x) / (p_l.y - p[0].y);
-    real32 dx_r = (p_r.x - p[0].x) / (p_r.y - p[0].y);
-    real32 x_l = p[0].x;
-    real32 x_r = x_l;
-    for (int32 y = max(0, p[0].y); y <= min(p_l.y - 1, fb.height - 1); y++) {
-        if (y >= 0) {
-            for (int32 x = max(0, x_l); x <= min(fb.width - 1, x_r - 1); x++) {
-                uint32 *old = &fb.data[x + y * fb.width];
-                v4 old_c = pixel_to_color(*old);
-                *old = color_to_pixel(color_blend(color, old_c));
+        MipLevel l = *src->level;
+        const uint32 *t = l.texels;
+        for (int32 i = 0; i < count; i++) {
+            int32 u0 = su >> 16;
+            int32 v0 = sv >> 16;
+            int32 u1 = u0 + 1;
+            int32 v1 = v0 + 1;
+            if (CLAMP) {
+                u0 = min(max(u0, u_min), u_max);
+                u1 = min(max(u1, u_min), u_max);
+                v0 = min(max(v0, v_min), v_max);
+                v1 = min(max(v1, v_min), v_max);
             }
-            x_l += dx_l;
-            x_r += dx_r;
+            uint32 fu = (su >> 8) & 0xFF;
+            uint32 fv = (sv >> 8) & 0xFF;
+            const uint32 *row0 = t + mip_row(&l, v0);
+            const uint32 *row1 = t + mip_row(&l, v1);
+            uint32 c0 = mip_column(u0);
+            uint32 c1 = mip_column(u1);
+            uint32 top = lerp_pixel(row0[c0], row0[c1], fu);
+            uint32 bottom = lerp_pixel(row1[c0], row1[c1], fu);
+            texels[i] = lerp_pixel(top, bottom, fv);
+            su += du;
+            sv += dv;
         }
     }
+    *u = su;
+    *v = sv;
+}
+
+/* Sample 'count' texels at the 16.16 coordinates (u, v), stepped by (du, dv)
+ * per texel, and leave (u, v) behind the last one.
+ *
+ * Nearest sampling takes the texel the coordinates fall into. Bilinear
+ * filtering blends it with its right and lower neighbors. The coordinates are
+ * linear, so if the first and the last texel are inside the clamp rectangle,
+ * all of them are and the lookups skip clamping.
+ */
+static inline void
+sample_texels(const TexelSource *src, uint32 *texels, int32 count, int32 *u, int32 *v, int32 du, int32 dv) {
+    int32 reach = src->level && src->bilinear ? 1 : 0;
+    int32 u_first = *u >> 16;
+    int32 v_first = *v >> 16;
+    int32 u_last = (int32)(((int64)*u + (int64)du * (count - 1)) >> 16);
+    int32 v_last = (int32)(((int64)*v + (int64)dv * (count - 1)) >> 16);
+    if (min(u_first, u_last) >= src->u_min && max(u_first, u_last) + reach <= src->u_max &&
+        min(v_first, v_last) >= src->v_min && max(v_first, v_last) + reach <= src->v_max)
+        sample_texel_loop<false>(src, texels, count, u, v, du, dv);
+    else
+        sample_texel_loop<true>(src, texels, count, u, v, du, dv);
 }
 
+static inline int32
+ceil_to_range(real32 v, int32 lo, int32 hi) {
+    if (v <= (real32)lo)
+        return lo;
+    if (v >= (real32)hi)
+        return hi;
+    return (int32)ceilf(v);
+}
 
+/* Shade the pixels [x_begin, x_end) of the row span [span_begin, span_end).
+ *
+ * Interpolation is anchored at the unclipped span, so a pixel gets the same
+ * value no matter how the row is clipped, e.g. by tile boundaries. Every
+ * branch on S and B is resolved at compile time, so each instantiation only
+ * contains the work its state combination needs. Colors and texels are
+ * premultiplied. Translucent pixels are shaded into a small chunk first and
+ * then blended with the packed SIMD kernels.
+ */
+template <ShadeMode S, BlendMode B>
 static void
-draw_fragment(Framebuffer fb, uint32 x, uint32 y, v2 *pos, v4 *vcolor, Texture *texture, v2 *tex_coord, real32 area2, v4 *solid_color) {
-    v2 p = {(real32) x, (real32) y};
-    real32 c0 = det(p, pos[1], pos[2]) / area2;
-    real32 c1 = det(p, pos[2], pos[0]) / area2;
-    real32 c2 = 1.0f - c0 - c1;
-    v4 fg_color;
-    if (solid_color) {
-        fg_color = *solid_color;
+shade_span(uint32 *row, int32 span_begin, int32 span_end, int32 x_begin, int32 x_end, int32 y, const TriangleSetup *ts) {
+    if (S == SHADE_SOLID) {
+        if (B == BLEND_OPAQUE) {
+            uint32 pixel = ts->solid_pixel;
+            for (int32 x = x_begin; x < x_end; x++)
+                row[x] = pixel;
+        }
+        else {
+            blend_span_solid_premultiplied(row + x_begin, ts->solid_pixel, x_end - x_begin);
+        }
+        return;
     }
-    else if ((c0 - 1) * c0 <= 0 && (c1 - 1) * c1 <= 0 && (c2 - 1) * c2 <= 0) {
-        if (vcolor) {
-            fg_color = c0 * vcolor[0] + c1 * vcolor[1] + c2 * vcolor[2];
+    // Step the vertex color endpoints in fixed point. Both ends are clamped,
+    // so every value in between stays a valid channel.
+    v2 d = {span_begin - ts->origin.x, y - ts->origin.y};
+    v4 color = ts->color + ts->color_dx * d.x + ts->color_dy * d.y;
+    FixedColor c = fixed_color(color);
+    FixedColor c_end = fixed_color(color + ts->color_dx * (real32)(span_end - 1 - span_begin));
+    int32 n = max(span_end - span_begin - 1, 1);
+    FixedColor step = {(c_end.r - c.r) / n, (c_end.g - c.g) / n, (c_end.b - c.b) / n, (c_end.a - c.a) / n};
+    int32 skip = x_begin - span_begin;
+    c.r += step.r * skip;
+    c.g += step.g * skip;
+    c.b += step.b * skip;
+    c.a += step.a * skip;
+
+    int32 u = 0, v = 0, du = 0, dv = 0;
+    TexelSource src = {};
+    if (S == SHADE_TEXTURED) {
+        const Texture *texture = ts->texture;
+        const MipLevel *level = ts->level;
+        real32 side = (real32)min(texture->width, texture->height);
+        v2 scale = {1.0f, 1.0f};
+        real32 offset = 0.0f;
+        src.pixels = texture->pixels;
+        src.pitch = texture->width;
+        src.u_max = texture->width - 1;
+        src.v_max = texture->height - 1;
+        if (level) {
+            scale = {(real32)level->width / texture->width, (real32)level->height / texture->height};
+            src.level = level;
+            src.u_max = level->width - 1;
+            src.v_max = level->height - 1;
+            // Texel centers sit on integer coordinates. Nearest sampling
+            // rounds, bilinear filtering starts at the texel to the left.
+            src.bilinear = texture->mips->bilinear;
+            if (src.bilinear)
+                offset = -0.5f;
         }
-        if (texture) {
-            v2 uv = c0 * tex_coord[0] + c1 * tex_coord[1] + c2 * tex_coord[2];
-            uint32 shortest_side = min(texture->width, texture->height);
-            uint32 u = round(uv.x * shortest_side); // TODO: Round or floor here?
-            uint32 v = round(uv.y * shortest_side);
-            fg_color = color_blend(pixel_to_color(texture->pixels[u + v * texture->width]), fg_color);
+        v2 uv = ts->uv + ts->uv_dx * d.x + ts->uv_dy * d.y;
+        u = fixed_texel((uv.x * side + 0.5f) * scale.x + offset);
+        v = fixed_texel((uv.y * side + 0.5f) * scale.y + offset);
+        du = fixed_texel(ts->uv_dx.x * side * scale.x);
+        dv = fixed_texel(ts->uv_dx.y * side * scale.y);
+        u += du * skip;
+        v += dv * skip;
+    }
+
+    static constexpr int32 CHUNK = 64;
+    uint32 vcolors[CHUNK];
+    uint32 texels[CHUNK];
+    for (int32 x = x_begin; x < x_end; x += CHUNK) {
+        int32 count = min(CHUNK, x_end - x);
+        // Opaque vertex colors go straight to the framebuffer.
+        uint32 *vcolor_out = B == BLEND_OPAQUE ? row + x : vcolors;
+        for (int32 i = 0; i < count; i++) {
+            vcolor_out[i] = fixed_color_to_pixel(c);
+            c.r += step.r;
+            c.g += step.g;
+            c.b += step.b;
+            c.a += step.a;
+        }
+        if (B == BLEND_ALPHA) {
+            blend_span_premultiplied(row + x, vcolors, count);
+        }
+        if (S == SHADE_TEXTURED) {
+            sample_texels(&src, texels, count, &u, &v, du, dv);
+            blend_span_premultiplied(row + x, texels, count);
         }
     }
-    uint32 *old = &fb.data[x + y * fb.width];
-    v4 old_c = pixel_to_color(*old);
-    *old = color_to_pixel(fragment_shader(old_c, fg_color));
 }
 
+template <ShadeMode S, BlendMode B>
 static void
-draw_flat_bottom_triangle(Framebuffer fb, v2 *pos, v4 *color, v2 *tex_coord, Texture *texture, v4 *solid_color) {
-    assert(pos[0].y < pos[1].y && pos[0].y < pos[2].y);
-    assert(round(pos[1].y) == round(pos[2].y));
-    v2 p_l = pos[1].x < pos[2].x ? pos[1] : pos[2];
-    v2 p_r = pos[1].x > pos[2].x ? pos[1] : pos[2];
-    real32 dx_l = (p_l.x - pos[0].x) / (p_l.y - pos[0].y);
-    real32 dx_r = (p_r.x - pos[0].x) / (p_r.y - pos[0].y);
-    real32 x_l = pos[0].x;
-    real32 x_r = x_l;
-    real32 area2 = det(pos[0], pos[1], pos[2]);
-    for (int32 y = pos[0].y; y <= min(p_l.y, fb.height - 1); y++) {
-        if (y >= 0) {
-            for (int32 x = max(0, x_l); x <= min(fb.width - 1, x_r - 1); x++) {
-                draw_fragment(fb, x, y, pos, color, texture, tex_coord, area2, solid_color);
+raster_triangle(Framebuffer fb, const TriangleSetup *ts) {
+    // Sample points are integer pixel coordinates. Rows and columns are
+    // covered on [ceil(begin), ceil(end)), so triangles sharing an edge never
+    // touch the same pixel twice.
+    const v2 *p = ts->pos;
+    real32 dxdy_long = (p[2].x - p[0].x) / (p[2].y - p[0].y);
+    real32 dxdy_top = p[1].y > p[0].y ? (p[1].x - p[0].x) / (p[1].y - p[0].y) : 0;
+    real32 dxdy_bottom = p[2].y > p[1].y ? (p[2].x - p[1].x) / (p[2].y - p[1].y) : 0;
+    int32 y_begin = ceil_to_range(p[0].y, fb.clip_y0, fb.clip_y1);
+    int32 y_mid = ceil_to_range(p[1].y, fb.clip_y0, fb.clip_y1);
+    int32 y_end = ceil_to_range(p[2].y, fb.clip_y0, fb.clip_y1);
+    static constexpr int32 SPAN_LIMIT = 1 << 20;
+    for (int32 y = y_begin; y < y_end; y++) {
+        real32 x_long = p[0].x + (y - p[0].y) * dxdy_long;
+        real32 x_short = y < y_mid ? p[0].x + (y - p[0].y) * dxdy_top : p[1].x + (y - p[1].y) * dxdy_bottom;
+        int32 span_begin = ceil_to_range(min(x_long, x_short), -SPAN_LIMIT, SPAN_LIMIT);
+        int32 span_end = ceil_to_range(max(x_long, x_short), -SPAN_LIMIT, SPAN_LIMIT);
+        int32 x_begin = max(span_begin, fb.clip_x0);
+        int32 x_end = min(span_end, fb.clip_x1);
+        if (x_begin < x_end) {
+            shade_span<S, B>(fb.data + y * fb.width, span_begin, span_end, x_begin, x_end, y, ts);
+        }
+    }
+}
+
+/* Anti-aliased convex polygon, the shading is the same as raster_triangle's.
+ *
+ * Only the partially covered pixels at the ends of a row are shaded into a
+ * scratch chunk and blended by their coverage. The fully covered interior
+ * takes the aliased span path. Interpolation is anchored at the span of all
+ * touched pixels, which may reach half a pixel past the polygon. With
+ * occlusion culling the interior is drawn in the front pass and the edges in
+ * the back pass.
+ */
+template <ShadeMode S, BlendMode B>
+static void
+raster_polygon_aa(Framebuffer fb, const v2 *p, uint32 count, const TriangleSetup *ts) {
+    real32 y_min = p[0].y;
+    real32 y_max = p[0].y;
+    for (uint32 i = 1; i < count; i++) {
+        y_min = min(y_min, p[i].y);
+        y_max = max(y_max, p[i].y);
+    }
+    int32 y_begin = ceil_to_range(y_min - 0.5f, fb.clip_y0, fb.clip_y1);
+    int32 y_end = ceil_to_range(y_max + 0.5f, fb.clip_y0, fb.clip_y1);
+    assert(count <= MAX_VERTICES_PER_SHAPE);
+    CoverageEdge edges[MAX_VERTICES_PER_SHAPE];
+    uint32 edge_count = coverage_edges(p, count, edges);
+    static constexpr int32 CHUNK = 64;
+    uint32 shaded[CHUNK];
+    uint32 coverage[CHUNK];
+    if (S == SHADE_SOLID) {
+        for (int32 i = 0; i < CHUNK; i++)
+            shaded[i] = ts->solid_pixel;
+    }
+    for (int32 y = y_begin; y < y_end; y++) {
+        CoverageRow cr;
+        if (!coverage_row(edges, edge_count, y, &cr))
+            continue;
+        uint32 *row = fb.data + y * fb.width;
+        int32 inner_begin = max(cr.inner_begin, fb.clip_x0);
+        int32 inner_end = min(cr.inner_end, fb.clip_x1);
+        if (inner_begin < inner_end && fb.occlusion_pass != OCCLUSION_BACK) {
+            SpanCursor c = span_cursor(fb, y, inner_begin, inner_end);
+            int32 begin, end;
+            while (span_next(&c, &begin, &end))
+                shade_span<S, B>(row, cr.outer_begin, cr.outer_end, begin, end, y, ts);
+        }
+        if (fb.occlusion_pass == OCCLUSION_FRONT)
+            continue;
+        // Left and right edge
+        int32 runs[2][2] = {{cr.outer_begin, cr.inner_begin}, {cr.inner_end, cr.outer_end}};
+        for (uint32 e = 0; e < 2; e++) {
+            int32 x_begin = max(runs[e][0], fb.clip_x0);
+            int32 x_end = min(runs[e][1], fb.clip_x1);
+            for (int32 x = x_begin; x < x_end; x += CHUNK) {
+                int32 n = min(CHUNK, x_end - x);
+                if (S != SHADE_SOLID) {
+                    // The scratch chunk stands in for the row at x.
+                    shade_span<S, BLEND_OPAQUE>(shaded - x, cr.outer_begin, cr.outer_end, x, x + n, y, ts);
+                }
+                span_coverage(&cr, x, n, coverage);
+                if (fb.occlusion_pass == OCCLUSION_BACK) {
+                    SpanCursor c = span_cursor(fb, y, x, x + n);
+                    int32 begin, end;
+                    while (span_next(&c, &begin, &end))
+                        blend_span_coverage(row + begin, shaded + begin - x, coverage + begin - x, end - begin);
+                    continue;
+                }
+                // Edge runs are short and of random length. Rounding them up
+                // to whole groups of four saves the mispredicted scalar
+                // tails, the extra pixels get no coverage and stay as they
+                // are.
+                int32 padded = min((n + 3) & ~3, fb.clip_x1 - x);
+                blend_span_coverage(row + x, shaded, coverage, padded);
             }
         }
-        x_l += dx_l;
-        x_r += dx_r;
+    }
+}
+
+template <ShadeMode S, BlendMode B>
+static void
+raster_triangle_aa(Framebuffer fb, const TriangleSetup *ts) {
+    raster_polygon_aa<S, B>(fb, ts->pos, 3, ts);
+}
+
+static TrianglePipeline
+select_pipeline(ShadeMode shade, bool translucent, bool antialias) {
+    static const TrianglePipeline pipelines[SHADE_COUNT][BLEND_COUNT] = {
+        {raster_triangle<SHADE_SOLID, BLEND_OPAQUE>, raster_triangle<SHADE_SOLID, BLEND_ALPHA>},
+        {raster_triangle<SHADE_GOURAUD, BLEND_OPAQUE>, raster_triangle<SHADE_GOURAUD, BLEND_ALPHA>},
+        {raster_triangle<SHADE_TEXTURED, BLEND_OPAQUE>, raster_triangle<SHADE_TEXTURED, BLEND_ALPHA>}
+    };
+    static const TrianglePipeline pipelines_aa[SHADE_COUNT][BLEND_COUNT] = {
+        {raster_triangle_aa<SHADE_SOLID, BLEND_OPAQUE>, raster_triangle_aa<SHADE_SOLID, BLEND_ALPHA>},
+        {raster_triangle_aa<SHADE_GOURAUD, BLEND_OPAQUE>, raster_triangle_aa<SHADE_GOURAUD, BLEND_ALPHA>},
+        {raster_triangle_aa<SHADE_TEXTURED, BLEND_OPAQUE>, raster_triangle_aa<SHADE_TEXTURED, BLEND_ALPHA>}
+    };
+    BlendMode blend = translucent ? BLEND_ALPHA : BLEND_OPAQUE;
+    return antialias ? pipelines_aa[shade][blend] : pipelines[shade][blend];
+}
+
+static bool
+setup_triangle(TriangleSetup *ts, const v2 *pos, const v4 *color, const v2 *tex_coord) {
+    v2 e1 = pos[1] - pos[0];
+    v2 e2 = pos[2] - pos[0];
+    real32 area2 = e1.x * e2.y - e2.x * e1.y;
+    if (abs(area2) < EPSILON)
+        return false;
+    real32 inv_area2 = 1.0f / area2;
+    ts->origin = pos[0];
+    ts->color = color[0];
+    v4 dc1 = color[1] - color[0];
+    v4 dc2 = color[2] - color[0];
+    ts->color_dx = (dc1 * e2.y - dc2 * e1.y) * inv_area2;
+    ts->color_dy = (dc2 * e1.x - dc1 * e2.x) * inv_area2;
+    ts->uv = tex_coord[0];
+    v2 duv1 = tex_coord[1] - tex_coord[0];
+    v2 duv2 = tex_coord[2] - tex_coord[0];
+    ts->uv_dx = (duv1 * e2.y - duv2 * e1.y) * inv_area2;
+    ts->uv_dy = (duv2 * e1.x - duv1 * e2.x) * inv_area2;
+    // Attributes are planes, so only the positions need sorting.
+    ts->pos[0] = pos[0];
+    ts->pos[1] = pos[1];
+    ts->pos[2] = pos[2];
+    v2 tmp;
+    if (ts->pos[0].y > ts->pos[2].y) {
+        tmp = ts->pos[0]; ts->pos[0] = ts->pos[2]; ts->pos[2] = tmp;
+    }
+    if (ts->pos[0].y > ts->pos[1].y) {
+        tmp = ts->pos[0]; ts->pos[0] = ts->pos[1]; ts->pos[1] = tmp;
+    }
+    if (ts->pos[1].y > ts->pos[2].y) {
+        tmp = ts->pos[1]; ts->pos[1] = ts->pos[2]; ts->pos[2] = tmp;
+    }
+    ts->level = 0;
+    if (ts->texture && ts->texture->mips) {
+        // The mapping is affine, so one level suits the whole triangle: the
+        // one closest to the longer texel step per pixel, rounded in log2.
+        const MipChain *mips = ts->texture->mips;
+        real32 side = (real32)min(ts->texture->width, ts->texture->height);
+        real32 step2 = max(dot(ts->uv_dx, ts->uv_dx), dot(ts->uv_dy, ts->uv_dy)) * side * side;
+        ts->level = &mips->levels[select_mip_level(mips, step2)];
+    }
+    return true;
+}
+
+static void
+draw_indexed_triangles(Framebuffer fb, const ShadedVertex *vertices, uint32 vertex_count, const uint32 *indices, uint32 index_count, uint32 first_index, Texture *texture, v4 *color, bool antialias) {
+    // The pipeline is chosen once per draw call. A solid color wins over
+    // vertex colors, which are drawn below the texture if there is one.
+    ShadeMode shade = color ? SHADE_SOLID : (texture ? SHADE_TEXTURED : SHADE_GOURAUD);
+    bool translucent = false;
+    if (color) {
+        translucent = color->a < 1.0f - EPSILON;
+    }
+    else {
+        for (uint32 i = 0; i < vertex_count && !translucent; i++) {
+            translucent = vertices[i].color.a < 1.0f - EPSILON;
+        }
+    }
+    TrianglePipeline pipeline = select_pipeline(shade, translucent, antialias);
+    TriangleSetup ts = {};
+    ts.texture = texture;
+    if (color) {
+        ts.solid_pixel = premultiply_pixel(color_to_pixel(*color));
+    }
+    // Indices count from 'first_index', the first entry of 'vertices'.
+    for (uint32 i = 0; i + 2 < index_count; i += 3) {
+        v2 pos[3];
+        v4 vcolor[3];
+        v2 tex_coord[3];
+        for (uint32 j = 0; j < 3; j++) {
+            const ShadedVertex *v = &vertices[indices[i + j] - first_index];
+            pos[j] = v->pos;
+            vcolor[j] = v->color;
+            tex_coord[j] = v->tex_coord;
+        }
+        if (setup_triangle(&ts, pos, vcolor, tex_coord)) {
+            submit_triangle(fb, pipeline, &ts);
+        }
+    }
+}
+
+static void
+submit_triangle(Framebuffer fb, TrianglePipeline pipeline, const TriangleSetup *ts) {
+    if (!fb.tiles) {
+        pipeline(fb, ts);
+        return;
+    }
+    // Positions are sorted by y. Anti-aliased edges reach half a pixel past
+    // the triangle.
+    real32 margin = fb.antialias ? 1.0f : 0.0f;
+    v2 min = {min(min(ts->pos[0].x, ts->pos[1].x), ts->pos[2].x) - margin, ts->pos[0].y - margin};
+    v2 max = {max(max(ts->pos[0].x, ts->pos[1].x), ts->pos[2].x) + margin, ts->pos[2].y + margin};
+    TriangleCommand *cmd = (TriangleCommand *)tile_push(fb, min, max, execute_triangle, sizeof(TriangleCommand));
+    if (cmd) {
+        cmd->pipeline = pipeline;
+        cmd->setup = *ts;
     }
 }
 
 static void
-draw_flat_top_triangle(Framebuffer fb, v2 *pos, v4 *color, v2 *tex_coord, Texture *texture, v4 *solid_color) {
-    assert(pos[2].y > pos[0].y && pos[2].y > pos[1].y);
-    assert(round(pos[0].y) == round(pos[1].y));
-    v2 p_l = pos[0].x < pos[1].x ? pos[0] : pos[1];
-    v2 p_r = pos[0].x > pos[1].x ? pos[0] : pos[1];
-    real32 dx_l = (p_l.x - pos[2].x) / (p_l.y - pos[2].y);
-    real32 dx_r = (p_r.x - pos[2].x) / (p_r.y - pos[2].y);
-    real32 x_l = p_l.x;
-    real32 x_r = p_r.x;
-    real32 area2 = det(pos[0], pos[1], pos[2]);
-    for (int32 y = p_l.y; y <= min(pos[2].y, fb.height - 1); y++) {
-        if (y >= 0) {
-            for (int32 x = max(0, x_l); x <= min(fb.width - 1, x_r - 1); x++) {
-                draw_fragment(fb, x, y, pos, color, texture, tex_coord, area2, solid_color);
+raster_convex_polygon(Framebuffer fb, const v2 *vertices, const v2 *normals, uint32 count, v2 start, v2 end, uint32 pixel) {
+    if (fb.antialias) {
+        TriangleSetup ts = {};
+        ts.solid_pixel = premultiply_pixel(pixel);
+        raster_polygon_aa<SHADE_SOLID, BLEND_OPAQUE>(fb, vertices, count, &ts);
+        return;
+    }
+    int32 y_begin = ceil_to_range(start.y, fb.clip_y0, fb.clip_y1);
+    int32 y_end = ceil_to_range(end.y, fb.clip_y0, fb.clip_y1);
+    int32 x_begin = ceil_to_range(start.x, fb.clip_x0, fb.clip_x1);
+    int32 x_end = ceil_to_range(end.x, fb.clip_x0, fb.clip_x1);
+    for (int32 y = y_begin; y < y_end; y++) {
+        // Every edge test is monotonic in x, so the pixels inside form one
+        // run.
+        int32 run_begin = x_end;
+        int32 run_end = x_end;
+        for (int32 x = x_begin; x < x_end; x++) {
+            bool contains = true;
+            uint32 v_index = 0;
+            v2 point = {(real32) x, (real32) y};
+            while (contains && v_index < count) {
+                real32 dot_product = dot(point - vertices[v_index], normals[v_index]);
+                if (dot_product > 0) {
+                    contains = false;
+                }
+                v_index++;
+            }
+            if (contains && run_begin == x_end) {
+                run_begin = x;
+            }
+            else if (!contains && run_begin < x_end) {
+                run_end = x;
+                break;
             }
         }
-        x_l += dx_l;
-        x_r += dx_r;
+        fill_row(fb, y, run_begin, run_end, pixel);
     }
 }
 
 static void
-debug_draw_flat_top_triangle(Framebuffer fb, const v2 *p, v4 color) {
-    //uint32 pixel = color_to_pixel(color);
-    assert(p[2].y > p[0].y && p[2].y > p[1].y);
-    assert(round(p[0].y) == round(p[1].y));
-    v2 p_l = p[0].x < p[1].x ? p[0] : p[1];
-    v2 p_r = p[0].x > p[1].x ? p[0] : p[1];
-    real32 dx_l = (p_l.x - p[2].x) / (p_l.y - p[2].y);
-    real32 dx_r = (p_r.x - p[2].x) / (p_r.y - p[2].y);
-    real32 x_l = p_l.x;
-    real32 x_r = p_r.x;
-    for (int32 y = max(0, p_l.y); y <= min(p[2].y - 1, fb.height - 1); y++) {
-        if (y >= 0) {
-            for (int32 x = max(0, x_l); x <= min(fb.width - 1, x_r - 1); x++) {
-                uint32 *old = &fb.data[x + y * fb.width];
-                v4 old_c = pixel_to_color(*old);
-                *old = color_to_pixel(color_blend(color, old_c));
+push_capsule(Framebuffer fb, v2 a, v2 b, real32 radius, uint32 pixel) {
+    if (!(radius >= 0))
+        return;
+    if (!fb.tiles) {
+        raster_capsule(fb, a, b, radius, pixel);
+        return;
+    }
+    v2 min = {min(a.x, b.x) - radius, min(a.y, b.y) - radius};
+    v2 max = {max(a.x, b.x) + radius, max(a.y, b.y) + radius};
+    CapsuleCommand *cmd = (CapsuleCommand *)tile_push(fb, min, max, execute_capsule, sizeof(CapsuleCommand));
+    if (cmd) {
+        cmd->a = a;
+        cmd->b = b;
+        cmd->radius = radius;
+        cmd->pixel = pixel;
+    }
+}
+
+/* Points within 'radius' of the segment [a, b], a circle if a == b.
+ *
+ * A capsule is convex, so every row is a single span: the union of the rows
+ * of both end circles and of the rectangle between them. Like the polygon
+ * filler it samples at integer coordinates and fills whole spans clipped to
+ * the clip rectangle.
+ */
+static void
+raster_capsule(Framebuffer fb, v2 a, v2 b, real32 radius, uint32 pixel) {
+    real32 r_sq = radius * radius;
+    v2 side = {};
+    v2 d = b - a;
+    real32 length = magnitude(d);
+    if (length > 0)
+        side = lnormal(d) * (radius / length);
+    v2 rect[4] = {a + side, b + side, b - side, a - side};
+    int32 y_begin = ceil_to_range(min(a.y, b.y) - radius, fb.clip_y0, fb.clip_y1);
+    int32 y_end = ceil_to_range(nextafterf(max(a.y, b.y) + radius, FLT_MAX), fb.clip_y0, fb.clip_y1);
+    for (int32 y = y_begin; y < y_end; y++) {
+        real32 left = FLT_MAX;
+        real32 right = -FLT_MAX;
+        real32 dy = y - a.y;
+        if (dy * dy <= r_sq) {
+            real32 h = sqrtf(r_sq - dy * dy);
+            left = min(left, a.x - h);
+            right = max(right, a.x + h);
+        }
+        dy = y - b.y;
+        if (dy * dy <= r_sq) {
+            real32 h = sqrtf(r_sq - dy * dy);
+            left = min(left, b.x - h);
+            right = max(right, b.x + h);
+        }
+        if (length > 0) {
+            for (uint32 i = 0; i < 4; i++) {
+                v2 p0 = rect[i];
+                v2 p1 = rect[(i + 1) % 4];
+                if ((y < p0.y) == (y < p1.y))
+                    continue;
+                real32 x = p0.x + (p1.x - p0.x) * ((y - p0.y) / (p1.y - p0.y));
+                left = min(left, x);
+                right = max(right, x);
             }
-            x_l += dx_l;
-            x_r += dx_r;
         }
+        if (left > right)
+            continue;
+        int32 x_begin = ceil_to_range(left, fb.clip_x0, fb.clip_x1);
+        int32 x_end = ceil_to_range(nextafterf(right, FLT_MAX), fb.clip_x0, fb.clip_x1);
+        fill_row(fb, y, x_begin, x_end, pixel);
     }
 }
 
 static void
-vertex_shader(Vertex v, Camera cam, Transform t, v2 *screen_pos, v4 *color, v2 *tex_coord) {
-    *screen_pos = world_to_screen_space(transform(v.coord, t), cam);
-    *color = v.color;
-    *tex_coord = v.tex_coord;
+execute_capsule(Framebuffer fb, const void *data) {
+    const CapsuleCommand *cmd = (const CapsuleCommand *)data;
+    raster_capsule(fb, cmd->a, cmd->b, cmd->radius, cmd->pixel);
 }
 
-static v4
-fragment_shader(v4 bg_color, v4 fg_color) {
-    return color_blend(fg_color, bg_color);
+/* Coverage of the pixel row y, whose pixels span [x - 0.5, x + 0.5] x
+ * [y - 0.5, y + 0.5] around their integer sample points.
+ *
+ * The row is cut into AA_SUBROWS sub-rows, on each of which the polygon
+ * covers one exact interval. A pixel's coverage is its mean overlap with
+ * these intervals, which is exact horizontally and 4x supersampled
+ * vertically. Returns false if the polygon misses the row.
+ */
+static bool
+coverage_row(const CoverageEdge *edges, uint32 count, int32 y, CoverageRow *cr) {
+    // Out of range values only need to stay ordered. Sub-rows the polygon
+    // misses get an empty interval.
+    static constexpr real32 SPAN_LIMIT = (real32)(1 << 20);
+#if defined(__SSE2__) && AA_SUBROWS == 4
+    // One lane per sub-row
+    __m128 sy = _mm_add_ps(_mm_set1_ps((real32)y), _mm_set_ps(0.375f, 0.125f, -0.125f, -0.375f));
+    __m128 limit = _mm_set1_ps(SPAN_LIMIT);
+    __m128 neg_limit = _mm_set1_ps(-SPAN_LIMIT);
+    __m128 left = limit;
+    __m128 right = neg_limit;
+    for (uint32 j = 0; j < count; j++) {
+        const CoverageEdge *e = &edges[j];
+        __m128 x = _mm_add_ps(_mm_set1_ps(e->x0), _mm_mul_ps(_mm_sub_ps(sy, _mm_set1_ps(e->y0)), _mm_set1_ps(e->dxdy)));
+        x = _mm_min_ps(_mm_max_ps(x, neg_limit), limit);
+        __m128 hit = _mm_and_ps(_mm_cmpge_ps(sy, _mm_set1_ps(e->y0)), _mm_cmplt_ps(sy, _mm_set1_ps(e->y1)));
+        left = _mm_or_ps(_mm_and_ps(hit, _mm_min_ps(left, x)), _mm_andnot_ps(hit, left));
+        right = _mm_or_ps(_mm_and_ps(hit, _mm_max_ps(right, x)), _mm_andnot_ps(hit, right));
+    }
+    __m128 valid = _mm_cmplt_ps(left, right);
+    _mm_storeu_ps(cr->left, _mm_or_ps(_mm_and_ps(valid, left), _mm_andnot_ps(valid, limit)));
+    _mm_storeu_ps(cr->right, _mm_or_ps(_mm_and_ps(valid, right), _mm_andnot_ps(valid, neg_limit)));
+    int32 valid_mask = _mm_movemask_ps(valid);
+    if (!valid_mask)
+        return false;
+    bool full = valid_mask == 0xF;
+#else
+    bool any = false;
+    bool full = true;
+    for (uint32 i = 0; i < AA_SUBROWS; i++) {
+        real32 sy = y - 0.5f + (i + 0.5f) / AA_SUBROWS;
+        real32 left = SPAN_LIMIT;
+        real32 right = -SPAN_LIMIT;
+        for (uint32 j = 0; j < count; j++) {
+            const CoverageEdge *e = &edges[j];
+            if (sy < e->y0 || sy >= e->y1)
+                continue;
+            real32 x = e->x0 + (sy - e->y0) * e->dxdy;
+            x = min(max(x, -SPAN_LIMIT), SPAN_LIMIT);
+            left = min(left, x);
+            right = max(right, x);
+        }
+        if (left < right) {
+            any = true;
+        }
+        else {
+            full = false;
+            left = SPAN_LIMIT;
+            right = -SPAN_LIMIT;
+        }
+        cr->left[i] = left;
+        cr->right[i] = right;
+    }
+    if (!any)
+        return false;
+#endif
+    real32 outer_left = cr->left[0];
+    real32 outer_right = cr->right[0];
+    real32 inner_left = cr->left[0];
+    real32 inner_right = cr->right[0];
+    for (uint32 i = 1; i < AA_SUBROWS; i++) {
+        outer_left = min(outer_left, cr->left[i]);
+        outer_right = max(outer_right, cr->right[i]);
+        inner_left = max(inner_left, cr->left[i]);
+        inner_right = min(inner_right, cr->right[i]);
+    }
+    cr->outer_begin = (int32)floorf(outer_left + 0.5f);
+    cr->outer_end = (int32)floorf(outer_right + 0.5f) + 1;
+    cr->inner_begin = cr->outer_end;
+    cr->inner_end = cr->outer_end;
+    if (full) {
+        int32 inner_begin = (int32)ceilf(inner_left + 0.5f);
+        int32 inner_end = (int32)floorf(inner_right - 0.5f) + 1;
+        if (inner_begin < inner_end) {
+            cr->inner_begin = inner_begin;
+            cr->inner_end = inner_end;
+        }
+    }
+    return true;
 }
 
-static int
-vertex_compare_pos_y(const void *a, const void *b) {
-    const Vertex *va = (Vertex *)a;
-    const Vertex *vb = (Vertex *)b;
-    if (va->coord.y > vb->coord.y)
-        return 1;
-    else if (va->coord.y < vb->coord.y)
-        return -1;
-    else
-        return 0;
+static uint32
+coverage_edges(const v2 *p, uint32 count, CoverageEdge *edges) {
+    uint32 edge_count = 0;
+    for (uint32 i = 0; i < count; i++) {
+        v2 a = p[i];
+        v2 b = p[i + 1 < count ? i + 1 : 0];
+        if (a.y == b.y)
+            continue;
+        if (a.y > b.y) {
+            v2 tmp = a; a = b; b = tmp;
+        }
+        CoverageEdge *e = &edges[edge_count++];
+        e->y0 = a.y;
+        e->y1 = b.y;
+        e->x0 = a.x;
+        e->dxdy = (b.x - a.x) / (b.y - a.y);
+    }
+    return edge_count;
 }
 
-static v2
-object_to_screen_space(v2 v, Camera c, v2 p, real32 ang) {
-    v2 result = rotate(v, {0, 0}, ang);
-    result += p; // Now we are in world space
-    result -= c.pos;
-    result *= c.scale;
-    v2 screen_center = 0.5 * v2{(real32)c.width, (real32)c.height};
-    result += screen_center;
-    return result;
+// Coverage in [0, 255] of the pixels [x, x + count), padded with zeros to a
+// multiple of four values.
+static void
+span_coverage(const CoverageRow *cr, int32 x, int32 count, uint32 *coverage) {
+    static constexpr real32 scale = 255.0f / AA_SUBROWS;
+    int32 i = 0;
+#if defined(__SSE2__)
+    // Four pixels at a time, summed over the sub-rows
+    const __m128 zero = _mm_setzero_ps();
+    for (; i < count; i += 4) {
+        __m128 x0 = _mm_add_ps(_mm_set1_ps(x + i - 0.5f), _mm_set_ps(3, 2, 1, 0));
+        __m128 x1 = _mm_add_ps(x0, _mm_set1_ps(1));
+        __m128 sum = zero;
+        for (uint32 j = 0; j < AA_SUBROWS; j++) {
+            __m128 overlap = _mm_sub_ps(_mm_min_ps(x1, _mm_set1_ps(cr->right[j])), _mm_max_ps(x0, _mm_set1_ps(cr->left[j])));
+            sum = _mm_add_ps(sum, _mm_max_ps(overlap, zero));
+        }
+        __m128i c = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(sum, _mm_set1_ps(scale)), _mm_set1_ps(0.5f)));
+        __m128i in_span = _mm_cmplt_epi32(_mm_add_epi32(_mm_set1_epi32(i), _mm_set_epi32(3, 2, 1, 0)), _mm_set1_epi32(count));
+        _mm_storeu_si128((__m128i *)(coverage + i), _mm_and_si128(c, in_span));
+    }
+#endif
+    for (; i < count; i++) {
+        real32 x0 = x + i - 0.5f;
+        real32 x1 = x + i + 0.5f;
+        real32 sum = 0;
+        for (uint32 j = 0; j < AA_SUBROWS; j++) {
+            real32 overlap = min(x1, cr->right[j]) - max(x0, cr->left[j]);
+            sum += max(overlap, 0.0f);
+        }
+        coverage[i] = (uint32)(sum * scale + 0.5f);
+    }
+    for (; i & 3; i++)
+        coverage[i] = 0;
+}
+
+static void
+execute_triangle(Framebuffer fb, const void *data) {
+    const TriangleCommand *cmd = (const TriangleCommand *)data;
+    cmd->pipeline(fb, &cmd->setup);
+}
+
+static void
+execute_polygon(Framebuffer fb, const void *data) {
+    const PolygonCommand *cmd = (const PolygonCommand *)data;
+    raster_convex_polygon(fb, cmd->vertices, cmd->normals, cmd->count, cmd->start, cmd->end, cmd->pixel);
 }
 
+static void
+execute_line(Framebuffer fb, const void *data) {
+    const LineCommand *cmd = (const LineCommand *)data;
+    raster_line(fb, cmd->a, cmd->b, cmd->pixel);
+}
+
+static void
+fill_clip_rect(Framebuffer fb, uint32 pixel) {
+    for (int32 y = fb.clip_y0; y < fb.clip_y1; y++) {
+        fill_row(fb, y, fb.clip_x0, fb.clip_x1, pixel);
+    }
+}
+
+// Fill the pixels of [x_begin, x_end) in row y the draw call may write.
+static void
+fill_row(Framebuffer fb, int32 y, int32 x_begin, int32 x_end, uint32 pixel) {
+    uint32 *row = fb.data + y * fb.width;
+    SpanCursor c = span_cursor(fb, y, x_begin, x_end);
+    int32 begin, end;
+    while (span_next(&c, &begin, &end)) {
+        for (int32 x = begin; x < end; x++)
+            row[x] = pixel;
+    }
+}
+
+static void
+execute_clear(Framebuffer fb, const void *data) {
+    fill_clip_rect(fb, ((const ClearCommand *)data)->pixel);
+}
+
+static void
+execute_blit(Framebuffer fb, const void *data) {
+    const BlitCommand *cmd = (const BlitCommand *)data;
+    draw_texture(fb, cmd->texture, cmd->x, cmd->y, cmd->blit);
+}
+
+static void
+execute_sprite(Framebuffer fb, const void *data) {
+    const SpriteCommand *cmd = (const SpriteCommand *)data;
+    draw_sprite(fb, cmd->texture, cmd->center, cmd->scale, cmd->angle, cmd->blit);
+}
+
+static void
+raster_glyph(Framebuffer fb, const GlyphCommand *glyph) {
+    int32 y_begin = max(glyph->y, fb.clip_y0);
+    int32 y_end = min(glyph->y + (int32)glyph->height, fb.clip_y1);
+    int32 x_begin = max(glyph->x, fb.clip_x0);
+    int32 x_end = min(glyph->x + (int32)glyph->width, fb.clip_x1);
+    if (glyph->rows) {
+        if (x_begin >= x_end)
+            return;
+        for (int32 y = y_begin; y < y_end; y++) {
+            uint32 bits = glyph_row_bits(glyph->rows + (y - glyph->y) * glyph->row_bytes, glyph->row_bytes);
+            blend_span_masked(fb.data + x_begin + y * fb.width, bits >> (x_begin - glyph->x), x_end - x_begin, glyph->tint);
+        }
+        return;
+    }
+    static constexpr int32 CHUNK = 64;
+    uint32 texels[CHUNK];
+    for (int32 y = y_begin; y < y_end; y++) {
+        const uint32 *src = glyph->bitmap.pixels + glyph->src_x - glyph->x + (glyph->src_y + y - glyph->y) * glyph->bitmap.width;
+        for (int32 x = x_begin; x < x_end; x += CHUNK) {
+            int32 count = min(CHUNK, x_end - x);
+            for (int32 i = 0; i < count; i++) {
+                texels[i] = modulate_pixel(src[x + i], glyph->tint);
+            }
+            blend_span_premultiplied(fb.data + x + y * fb.width, texels, count);
+        }
+    }
+}
+
+static void
+execute_glyph(Framebuffer fb, const void *data) {
+    raster_glyph(fb, (const GlyphCommand *)data);
+}
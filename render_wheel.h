@@ -1,9 +1,14 @@
 #ifndef RENDER_WHEEL_H
 
 #include "wheel.h"
+#include "pixel_wheel.h"
+#include "job_wheel.h"
+#include "tile_wheel.h"
+#include "span_wheel.h"
 #include "math_wheel.h"
 #include "shape_wheel.h"
 #include "mesh_wheel.h"
+#include "memory_wheel.h"
 
 struct Camera {
     v2 pos;
@@ -11,6 +16,35 @@ struct Camera {
     uint32 width, height;
 };
 
+#define MIP_TILE_SHIFT 2
+#define MIP_MAX_LEVELS 16
+
+// Color of bodies' shapes.
+#define SHAPE_PIXEL 0xFF605854
+
+struct MipLevel {
+    uint32 *texels; // Premultiplied, in tiles of 4x4 texels
+    uint32 width;
+    uint32 height;
+    uint32 tiles_x;
+};
+
+/* Mip chain of a texture, used when it is drawn on triangles.
+ *
+ * Level 0 has the size of the texture and every further level halves the one
+ * before with a box filter, down to 1x1. Triangles and sprites pick the level
+ * whose texels come closest to one per pixel. Texels are stored in 4x4 tiles, so the texels
+ * a rotated or scaled span walks over share cache lines.
+ *
+ * Level 0 is the only copy of the full size texels. A texture with a chain
+ * has no 'pixels', and blits read level 0 instead.
+ */
+struct MipChain {
+    MipLevel levels[MIP_MAX_LEVELS];
+    uint32 level_count;
+    bool bilinear; // Filter between the four nearest texels
+};
+
 struct Texture {
     union {
         uint32 *pixels;
@@ -18,15 +52,64 @@ struct Texture {
     };
     uint32 width;
     uint32 height;
+    MipChain *mips; // Optional
+};
+
+enum BlitMode {
+    BLIT_OPAQUE, // Copy texels
+    BLIT_ALPHA, // Blend premultiplied texels
+    BLIT_COLOR_KEY // Copy texels that differ from the color key
+};
+
+/* How draw_texture copies a texture.
+ *
+ * Only the source rectangle at (src_x, src_y) is drawn, e.g. one image of an
+ * atlas. Texels are multiplied by the premultiplied 'tint' first, 0xFFFFFFFF
+ * leaves them as they are. The color key is compared with untinted texels.
+ */
+struct Blit {
+    uint32 src_x, src_y;
+    uint32 width, height;
+    BlitMode mode;
+    uint32 tint;
+    uint32 color_key;
 };
 
+/* Monospaced bitmap font.
+ *
+ * Glyphs come either from a premultiplied 32-bit bitmap with the characters
+ * laid out in rows, or as 1-bit masks in 'glyphs': 'cheight' rows of
+ * 'row_bytes' bytes per glyph, lowest bit leftmost. Masks take precedence
+ * and are drawn in the text color.
+ */
 struct Font {
     Texture bitmap;
+    uint8 *glyphs;
+    uint32 row_bytes;
+    uint32 glyph_count;
     uint32 cwidth;
     uint32 cheight;
     uint32 ascii_offset;
 };
 
+// Mask rows of the glyph for 'c', 0 if the font has none.
+inline const uint8 *
+font_glyph_rows(const Font &f, char c) {
+    uint32 index = (uint8)c - f.ascii_offset;
+    if (index >= f.glyph_count)
+        return 0;
+    return f.glyphs + index * f.cheight * f.row_bytes;
+}
+
+inline uint32
+glyph_row_bits(const uint8 *row, uint32 row_bytes) {
+    uint32 bits = 0;
+    for (uint32 i = 0; i < row_bytes; i++) {
+        bits |= (uint32)row[i] << (8 * i);
+    }
+    return bits;
+}
+
 void
 renderer_draw_shape_to_buffer(Framebuffer fb, Camera c, Shape shape, v2 p, real32 p_ang);
 
@@ -36,21 +119,62 @@ draw_line(Framebuffer fb, v2 a, v2 b, v4 color);
 void
 draw_line(Framebuffer fb, v2 a, v2 b, v4 color, uint32 thickness);
 
+// Filled capsule around the segment [a, b], a circle if a == b.
+void
+draw_capsule(Framebuffer fb, v2 a, v2 b, real32 radius, v4 color);
+
 void
 clear_framebuffer(Framebuffer fb, v4 color);
 
+// Build the mip chain of a premultiplied texture. Its pixels have to come
+// from 'mem' and are handed back to it, see MipChain.
 void
-draw_triangle(Framebuffer fb, Vertex *v, Transform t, Camera c);
+texture_create_mips(Texture *texture, AppMemory *mem, bool bilinear);
+
+void
+draw_triangle(Framebuffer fb, Vertex *v, Transform t, Camera c, Texture *texture, v4 *color);
 
 void
 debug_draw_triangle(Framebuffer fb, v2 *p, v4 color);
 
+// Mesh vertices are shaded once into 'scratch', which is left as it was. If it
+// is 0 or full, every triangle shades its own vertices.
 void
-draw_mesh(const Camera &camera, Framebuffer fb, Mesh mesh, Transform t, Texture *texture, v4 *color);
+draw_mesh(const Camera &camera, Framebuffer fb, Mesh mesh, Transform t, Texture *texture, v4 *color, MemoryArena *scratch);
 
 void
 draw_mesh_wireframe(const Camera &camera, Framebuffer fb, Mesh mesh, Transform t, v4 color, uint32 thickness);
 
+// All of 'texture', untinted.
+inline Blit
+blit_texture(Texture texture, BlitMode mode) {
+    Blit blit = {};
+    blit.width = texture.width;
+    blit.height = texture.height;
+    blit.mode = mode;
+    blit.tint = 0xFFFFFFFF;
+    return blit;
+}
+
+// Draw the source rectangle of 'blit' with its top left corner at (x, y).
+void
+draw_texture(Framebuffer fb, Texture texture, int32 x, int32 y, const Blit &blit);
+
+// Screen space bounds of a sprite drawn with draw_sprite.
+BoundingBox
+sprite_bounds(v2 center, v2 scale, real32 angle, const Blit &blit);
+
+/* Draw the source rectangle of 'blit' scaled by 'scale' and rotated by
+ * 'angle' radians, clockwise on screen, around its center, which ends up at
+ * 'center'. At a scale of 1 and no rotation this matches draw_texture.
+ *
+ * Textures with mips are sampled like triangles: from the level matching the
+ * scale, bilinearly if the chain is filtered. Color keyed sprites always take
+ * the nearest texel of the texture itself.
+ */
+void
+draw_sprite(Framebuffer fb, Texture texture, v2 center, v2 scale, real32 angle, const Blit &blit);
+
 void
 debug_draw_texture(Texture bmp, Framebuffer fb, uint32 startx, uint32 starty);
 
@@ -63,6 +187,13 @@ debug_draw_vector(Framebuffer fb, v2 v, v2 offset, v4 color);
 void
 draw_string_to_texture(Texture *texture, const char *str, Font f, v4 color);
 
+void
+draw_string(Framebuffer fb, const char *str, Font f, v4 color, int32 x, int32 y);
+
+// Size of 'str' in pixels, with lines separated by '\n'.
+void
+text_size(const char *str, Font f, uint32 *width, uint32 *height);
+
 uint32
 color_to_pixel(v4 c);
 
@@ -84,5 +215,9 @@ world_to_screen_space(v2 coord, const Camera &camera);
 v2
 screen_to_world_space(v2 coord, const Camera &camera);
 
+// The part of the world the camera sees.
+BoundingBox
+camera_world_bounds(const Camera &camera);
+
 #define RENDER_WHEEL_H
 #endif
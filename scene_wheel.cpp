@@ -4,39 +4,80 @@
 static void
 draw_entities_wireframe(Scene *scene, Framebuffer fb);
 
+static real32
+grid_first_spacing(real32 unit);
+
+static bool
+draw_grid_level(RenderCommands *rc, uint64 key, DebugGrid *grid, real32 spacing, real32 origin, real32 begin, real32 end, real32 span_begin, real32 span_end, bool vertical);
+
+static v4
+grid_level_color(DebugGrid *grid, real32 spacing);
+
 void
-draw_grid(Scene *scene, Framebuffer fb) {
+draw_grid(Scene *scene, const Camera &camera, RenderCommands *rc) {
     // Draw grid
-    clear_framebuffer(fb, scene->grid.bg_color);
-    uint32 n_grid_lines_x = (uint32) (scene->camera.width / (scene->camera.scale * scene->grid.scale.x)) + 1;
-    uint32 n_grid_lines_y = (uint32) (scene->camera.height / (scene->camera.scale * scene->grid.scale.y)) + 1;
-    real32 dx = scene->camera.scale * scene->grid.scale.x;
-    real32 dy = scene->camera.scale * scene->grid.scale.y;
-    real32 x = (real32) (((int32)(0.5 * scene->camera.width - scene->camera.pos.x * scene->camera.scale)) % ((int32) dx)) - dx;
-    real32 y = (real32) (((int32)(0.5 * scene->camera.height - scene->camera.pos.y * scene->camera.scale)) % ((int32) dy)) - dy;
-    for (uint32 i = 0; i <= n_grid_lines_x; i++) {
-        draw_line(fb, {x, 0}, {x, (real32) scene->camera.height}, scene->grid.primary_color);
-        if (scene->camera.scale * scene->grid.scale.x > 100) {
-            for (uint32 j = 1; j < 10; j++) {
-                real32 ddx = j * dx / 10;
-                draw_line(fb, {x + ddx, 0}, {x + ddx, (real32) scene->camera.height}, scene->grid.secondary_color);
-            }
+    uint64 key = render_key(LAYER_BACKGROUND, 0, 0);
+    DebugGrid *grid = &scene->grid;
+    render_push_clear(rc, key, grid->bg_color);
+    // Only the area being recorded for is covered, which need not be the
+    // screen, e.g. for strips of a scrolled layer.
+    BoundingBox view = rc->screen;
+    // Screen position of the world origin. Lines are placed relative to it
+    // without accumulating, so any part of the grid comes out the same.
+    real32 ox = roundf(0.5f * camera.width - camera.pos.x * camera.scale);
+    real32 oy = roundf(0.5f * camera.height - camera.pos.y * camera.scale);
+    // Levels of both axes go from fine to coarse, so that brighter lines are
+    // drawn over fainter ones where they cross.
+    real32 sx = grid_first_spacing(camera.scale * grid->scale.x);
+    real32 sy = grid_first_spacing(camera.scale * grid->scale.y);
+    bool x_done = !(sx > 0);
+    bool y_done = !(sy > 0);
+    while (!x_done || !y_done) {
+        if (!x_done && (y_done || sx <= sy)) {
+            x_done = draw_grid_level(rc, key, grid, sx, ox, view.min.x, view.max.x, view.min.y, view.max.y, true);
+            sx *= 10;
         }
-        x += dx;
-    }
-    for (uint32 i = 0; i <= n_grid_lines_y; i++) {
-        draw_line(fb, {0, y}, {(real32) scene->camera.width, y}, scene->grid.primary_color);
-        if (scene->camera.scale * scene->grid.scale.y > 100) {
-            for (uint32 j = 1; j < 10; j++) {
-                real32 ddy = j * dy / 10;
-                draw_line(fb, {0, y + ddy}, {(real32) scene->camera.width, y + ddy}, scene->grid.secondary_color);
-            }
+        else {
+            y_done = draw_grid_level(rc, key, grid, sy, oy, view.min.y, view.max.y, view.min.x, view.max.x, false);
+            sy *= 10;
         }
-        y += dy;
     }
-    v2 origin = world_to_screen_space({0, 0}, scene->camera);
-    draw_line(fb, {origin.x, 0}, {origin.x, (real32) scene->camera.height}, scene->grid.accent_color, 5);
-    draw_line(fb, {0, origin.y}, {(real32) scene->camera.width, origin.y}, scene->grid.accent_color, 5);
+    render_push_line(rc, key, {ox, view.min.y}, {ox, view.max.y}, grid->accent_color, 5);
+    render_push_line(rc, key, {view.min.x, oy}, {view.max.x, oy}, grid->accent_color, 5);
+}
+
+/* The level is a tiled floor below the bodies.
+ *
+ * Every tile is the same unit square, scaled and moved into place, so the
+ * pieces can all point to one mesh on the stack: batch_build copies them out.
+ */
+void
+scene_build_level(Scene *scene, AppMemory *mem) {
+    static constexpr uint32 tile_count = 16;
+    static constexpr real32 tile_width = 0.5f;
+    static constexpr real32 floor_y = 1.5f;
+    batch_free(&scene->level, mem);
+
+    v2 positions[4];
+    uint32 indices[6];
+    Vertexbuffer vb = {{positions, 0, 0}, 0, 4};
+    Indexbuffer ib = {indices, 0, 6};
+    Mesh tile = create_rectangle(&vb, &ib, {0, 0}, {1, 1}, {1, 1, 1, 1});
+    v4 colors[2] = {
+        {0.35, 0.32, 0.30, 1},
+        {0.28, 0.26, 0.25, 1}
+    };
+    real32 left = -0.5f * tile_count * tile_width;
+    for (uint32 i = 0; i < tile_count; i++) {
+        Transform t = {{left + i * tile_width, floor_y}, {tile_width, 0.25f}, 0};
+        batch_add(scene->level_builder, tile, t, 0, &colors[i % 2]);
+    }
+    scene->level = batch_build(scene->level_builder, mem);
+}
+
+void
+scene_draw_level(Scene *scene, RenderCommands *rc) {
+    render_push_batches(rc, render_key(LAYER_WORLD, 0, 0), scene->camera, scene->level);
 }
 
 Scene *
@@ -45,6 +86,8 @@ initialize_scene(AppMemory *mem) {
 
     // Initialize entity components.
     scene->max_entity_count = 64;
+    scene->shape_meshes = shape_mesh_cache_create(mem, MAX_VERTEX_COUNT, 3 * MAX_VERTEX_COUNT);
+    scene->level_builder = batch_builder_create(mem, MAX_LEVEL_PIECES, 4.0f);
     //scene->entities = (uint32 *)get_memory(mem, scene->max_entity_count * sizeof(uint32));
 
     // Initialize camera.
@@ -69,3 +112,52 @@ initialize_scene(AppMemory *mem) {
     return scene;
 }
 
+/* Grid levels are the powers of ten of the grid scale.
+ *
+ * Levels closer than GRID_MIN_SPACING pixels are skipped and coarser levels
+ * stop once one is fully primary, so no more than a few hundred lines are
+ * drawn at any zoom. A level's color only depends on its spacing, which makes
+ * levels fade in and out smoothly while zooming.
+ */
+static real32
+grid_first_spacing(real32 unit) {
+    if (!(unit > 0))
+        return 0;
+    return unit * powf(10.0f, ceilf(log10f(GRID_MIN_SPACING / unit)));
+}
+
+/* Draw the lines of one level and axis. Returns true for the coarsest level.
+ *
+ * 'begin' and 'end' bound the line positions and 'span_begin' and 'span_end'
+ * the extent of every line.
+ */
+static bool
+draw_grid_level(RenderCommands *rc, uint64 key, DebugGrid *grid, real32 spacing, real32 origin, real32 begin, real32 end, real32 span_begin, real32 span_end, bool vertical) {
+    bool last = spacing >= GRID_PRIMARY_SPACING;
+    v4 color = grid_level_color(grid, spacing);
+    int32 i_begin = (int32)floorf((begin - origin) / spacing);
+    int32 i_end = (int32)floorf((end - origin) / spacing);
+    for (int32 i = i_begin; i <= i_end; i++) {
+        // Every tenth line belongs to the next level.
+        if (!last && i % 10 == 0)
+            continue;
+        real32 p = origin + i * spacing;
+        if (vertical)
+            render_push_line(rc, key, {p, span_begin}, {p, span_end}, color, 0);
+        else
+            render_push_line(rc, key, {span_begin, p}, {span_end, p}, color, 0);
+    }
+    return last;
+}
+
+static v4
+grid_level_color(DebugGrid *grid, real32 spacing) {
+    if (spacing >= GRID_PRIMARY_SPACING)
+        return grid->primary_color;
+    if (spacing >= GRID_SECONDARY_SPACING) {
+        real32 t = (spacing - GRID_SECONDARY_SPACING) / (GRID_PRIMARY_SPACING - GRID_SECONDARY_SPACING);
+        return grid->secondary_color + (grid->primary_color - grid->secondary_color) * t;
+    }
+    real32 t = max(spacing - GRID_MIN_SPACING, 0.0f) / (GRID_SECONDARY_SPACING - GRID_MIN_SPACING);
+    return grid->bg_color + (grid->secondary_color - grid->bg_color) * t;
+}
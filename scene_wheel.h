@@ -3,11 +3,20 @@
 #include "shape_wheel.h"
 #include "physics_wheel.h"
 #include "render_wheel.h"
+#include "command_wheel.h"
+#include "batch_wheel.h"
 #include "memory_wheel.h"
 
 #define MAX_VERTEX_COUNT 128
 #define MAX_BODIES_PER_ENTITY 16
 #define MAX_ENTITY_COUNT 64
+#define MAX_LEVEL_PIECES 64
+
+// Pixel spacings at which a grid level appears, is drawn in the secondary
+// color and is drawn in the primary color.
+#define GRID_MIN_SPACING 8.0f
+#define GRID_SECONDARY_SPACING 40.0f
+#define GRID_PRIMARY_SPACING 100.0f
 
 struct DebugGrid {
     v4 bg_color;
@@ -44,7 +53,11 @@ struct Scene {
     uint32 max_entity_count;
     Entity entities[MAX_ENTITY_COUNT];
     ShapeList shapes;
+    ShapeMeshCache *shape_meshes;
     BodyList bodies;
+    // Level geometry that never moves, drawn under the bodies.
+    BatchBuilder *level_builder;
+    StaticBatches level;
 };
 
 inline uint32
@@ -65,6 +78,12 @@ scene_create_polygon(Scene *scene, uint32 count, v2 *vertices) {
     return shape_create_polygon(&scene->shapes, count, v_ptr, n_ptr);
 }
 
+inline uint32
+scene_create_circle(Scene *scene, v2 center, real32 radius) {
+    assert(scene->shapes.count < MAX_SHAPE_COUNT);
+    return shape_create_circle(&scene->shapes, center, radius);
+}
+
 inline uint32
 scene_create_body(Scene *scene, BodyDef def) {
     return physics_create_body(&scene->bodies, def);
@@ -83,13 +102,28 @@ scene_link_body_to_entity(Scene *scene, uint32 body, uint32 entity) {
 }
 
 inline void
-scene_draw_bodies(Scene *scene, Framebuffer fb, AppMemory *mem) {
+scene_draw_bodies(Scene *scene, RenderCommands *rc, AppMemory *mem) {
     scene->vertices_unnecessary_copy = (v2 *)get_memory(mem, 100 * scene->vertex_count * sizeof(v2));
     char *unnecessary_string = (char *)get_memory(mem, 2000);
+    uint64 key = render_key(LAYER_WORLD, 0, 0);
     for (uint32 i = 0; i < scene->bodies.count; i++) {
         Body *b = &scene->bodies.bodies[i];
+        if (render_cull(rc, scene->camera, physics_get_body_bounds(b)))
+            continue;
         for (uint32 j = 0; j < b->shape_count; j++) {
-            renderer_draw_shape_to_buffer(fb, scene->camera, *b->shapes[j], b->p, b->p_ang);
+            const Shape &shape = *b->shapes[j];
+            // The half-plane test of shapes only fills convex outlines, the
+            // others go through the triangle pipeline.
+            const ShapeMesh *sm = 0;
+            if (shape.type == ST_POLYGON && !shape.polygon.convex)
+                sm = shape_mesh_get(scene->shape_meshes, shape, (uint32)(b->shapes[j] - scene->shapes.shapes));
+            if (sm) {
+                v4 color = pixel_to_color(SHAPE_PIXEL);
+                render_push_mesh(rc, key, scene->camera, sm->mesh, {b->p, {1, 1}, b->p_ang}, 0, &color);
+            }
+            else {
+                render_push_shape(rc, key, scene->camera, shape, b->p, b->p_ang);
+            }
         }
     }
     free_memory(mem, scene->vertices_unnecessary_copy, 100 * scene->vertex_count * sizeof(v2));
@@ -99,7 +133,14 @@ scene_draw_bodies(Scene *scene, Framebuffer fb, AppMemory *mem) {
 }
 
 void
-draw_grid(Scene *scene, Framebuffer fb);
+draw_grid(Scene *scene, const Camera &camera, RenderCommands *rc);
+
+// (Re)build the static level geometry, replacing the previous batches.
+void
+scene_build_level(Scene *scene, AppMemory *mem);
+
+void
+scene_draw_level(Scene *scene, RenderCommands *rc);
 
 void
 draw_scene(Scene *scene, Framebuffer fb);
@@ -23,6 +23,7 @@ shape_create_polygon(ShapeList *list, uint32 count, v2 *vertices, v2 *normals) {
     calculate_normals(count, vertices, normals);
     shape.polygon.vertices = vertices;
     shape.polygon.normals = normals;
+    shape.polygon.convex = polygon_is_convex(vertices, count);
     assert(list->count < MAX_SHAPE_COUNT);
     list->shapes[list->count] = shape;
     return list->count++;
@@ -30,7 +31,11 @@ shape_create_polygon(ShapeList *list, uint32 count, v2 *vertices, v2 *normals) {
 
 BoundingBox
 shape_get_bounding_box(Shape shape, real32 ang) {
-    // TODO: Implement this for other shape types
+    if (shape.type == ST_CIRCLE) {
+        v2 center = rotate(shape.circle.center, {0, 0}, ang);
+        v2 r = {shape.circle.radius, shape.circle.radius};
+        return {center - r, center + r};
+    }
     BoundingBox b = {
         {FLT_MAX, FLT_MAX},
         {-FLT_MAX, -FLT_MAX}
@@ -45,6 +50,22 @@ shape_get_bounding_box(Shape shape, real32 ang) {
     return b;
 }
 
+bool
+polygon_is_convex(const v2 *vertices, uint32 count) {
+    real32 winding = 0;
+    for (uint32 i = 0; i < count; i++) {
+        v2 a = vertices[i];
+        v2 b = vertices[(i + 1) % count];
+        v2 c = vertices[(i + 2) % count];
+        real32 turn = cross(b - a, c - b);
+        if (turn * winding < 0)
+            return false;
+        if (turn != 0)
+            winding = turn;
+    }
+    return true;
+}
+
 static void
 calculate_normals(uint32 count, v2 *vertices, v2 *normals) {
     for (uint32 i = 0; i < count; i++) {
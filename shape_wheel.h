@@ -17,10 +17,13 @@ struct ShapeCircle {
     real32 radius;
 };
 
+// The outline is fixed once the shape is created, its convexity and the
+// normals are computed only then.
 struct ShapePolygon {
     uint32 count;
     v2 *vertices;
     v2 *normals;
+    bool convex;
 };
 
 struct Shape {
@@ -40,6 +43,11 @@ struct BoundingBox {
     v2 min, max;
 };
 
+inline bool
+bounding_box_overlap(BoundingBox a, BoundingBox b) {
+    return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y && b.min.y <= a.max.y;
+}
+
 uint32
 shape_create_circle(ShapeList *list, v2 center, real32 radius);
 
@@ -49,6 +57,11 @@ shape_create_polygon(ShapeList *list, uint32 count, v2 *vertices, v2 *normals);
 BoundingBox
 shape_get_bounding_box(Shape shape, real32 ang);
 
+// True if every corner of the outline turns the same way. Collinear corners
+// do not count.
+bool
+polygon_is_convex(const v2 *vertices, uint32 count);
+
 
 #define SHAPE_WHEEL_H
 #endif
@@ -0,0 +1,77 @@
+#include "span_wheel.h"
+
+SpanBuffer *
+span_buffer_create(AppMemory *mem, int32 width, int32 height) {
+    SpanBuffer *sb = (SpanBuffer *)get_memory(mem, sizeof(SpanBuffer));
+    sb->width = width;
+    sb->height = height;
+    sb->columns = (width + SPAN_SEGMENT - 1) / SPAN_SEGMENT;
+    sb->spans = (Span *)get_memory(mem, sb->columns * height * SPAN_SEGMENT * sizeof(Span));
+    sb->counts = (uint8 *)get_memory(mem, sb->columns * height);
+    span_buffer_clear(sb);
+    return sb;
+}
+
+void
+span_buffer_clear(SpanBuffer *sb) {
+    memset(sb->counts, 0, sb->columns * sb->height);
+}
+
+bool
+span_next(SpanCursor *c, int32 *begin, int32 *end) {
+    if (c->pass == OCCLUSION_NONE) {
+        *begin = c->x;
+        *end = c->x_end;
+        c->x = c->x_end;
+        return *begin < *end;
+    }
+    // Runs continue across segment boundaries as long as nothing blocks them.
+    bool open = false;
+    while (c->x < c->x_end) {
+        int32 column = c->x / SPAN_SEGMENT;
+        int32 base = column * SPAN_SEGMENT;
+        uint32 segment = c->y * c->sb->columns + column;
+        Span *spans = c->sb->spans + segment * SPAN_SEGMENT;
+        uint32 count = c->sb->counts[segment];
+        int32 x = c->x - base;
+        int32 segment_end = min(c->x_end - base, SPAN_SEGMENT);
+        // First span that ends past x
+        uint32 i = 0;
+        while (i < count && spans[i].x1 <= x)
+            i++;
+        // In the front pass everything recorded so far lies in front.
+        bool blocked = i < count && spans[i].x0 <= x && (c->pass == OCCLUSION_FRONT || spans[i].depth > c->depth);
+        if (blocked) {
+            if (open)
+                break;
+            c->x = base + spans[i].x1;
+            continue;
+        }
+        int32 run_end = segment_end;
+        if (c->pass == OCCLUSION_FRONT) {
+            if (i < count)
+                run_end = min(run_end, (int32)spans[i].x0);
+            memmove(spans + i + 1, spans + i, (count - i) * sizeof(Span));
+            spans[i].x0 = (uint8)x;
+            spans[i].x1 = (uint8)run_end;
+            spans[i].depth = (uint16)c->depth;
+            c->sb->counts[segment]++;
+        }
+        else {
+            for (; i < count && spans[i].x0 < run_end; i++) {
+                if (spans[i].depth > c->depth) {
+                    run_end = spans[i].x0;
+                    break;
+                }
+            }
+        }
+        if (!open)
+            *begin = c->x;
+        open = true;
+        c->x = base + run_end;
+        if (run_end < SPAN_SEGMENT)
+            break;
+    }
+    *end = c->x;
+    return open;
+}
@@ -0,0 +1,77 @@
+#ifndef SPAN_WHEEL_H
+
+#include "wheel.h"
+#include "memory_wheel.h"
+#include "tile_wheel.h"
+
+#define SPAN_SEGMENT TILE_SIZE
+
+/* Span buffer (S-buffer) for occlusion culling.
+ *
+ * The buffer keeps, for every row, the spans of pixels that opaque draws have
+ * covered so far. Each span is tagged with the depth of its draw, which is
+ * the draw's position in the frame. Rows are split into segments of
+ * SPAN_SEGMENT pixels, one per tile column, so tile jobs never share one. A
+ * segment holds sorted, disjoint spans and cannot hold more spans than it has
+ * pixels, so it never overflows.
+ *
+ * A frame is drawn in two passes. In OCCLUSION_FRONT the opaque draws run
+ * front to back, write only the gaps between the spans and record them. In
+ * OCCLUSION_BACK everything else runs in the usual order and skips pixels
+ * that a span of a draw in front of it covers. Anti-aliased edges are drawn
+ * in the second pass, because they blend with what lies behind.
+ */
+struct Span {
+    uint8 x0, x1; // [x0, x1) relative to the segment
+    uint16 depth;
+};
+
+struct SpanBuffer {
+    Span *spans; // SPAN_SEGMENT per segment
+    uint8 *counts; // Per segment
+    int32 width, height;
+    int32 columns;
+};
+
+// Walks the runs of a row that the current draw call may write.
+struct SpanCursor {
+    SpanBuffer *sb;
+    OcclusionPass pass;
+    uint32 depth;
+    int32 y, x, x_end;
+};
+
+SpanBuffer *
+span_buffer_create(AppMemory *mem, int32 width, int32 height);
+
+void
+span_buffer_clear(SpanBuffer *sb);
+
+inline bool
+span_buffer_fits(const SpanBuffer *sb, Framebuffer fb) {
+    return fb.width <= sb->width && fb.height <= sb->height;
+}
+
+// Cursor over [x0, x1) of row y for the draw call 'fb' belongs to.
+inline SpanCursor
+span_cursor(Framebuffer fb, int32 y, int32 x0, int32 x1) {
+    SpanCursor c;
+    c.sb = fb.occlusion;
+    c.pass = fb.occlusion ? fb.occlusion_pass : OCCLUSION_NONE;
+    c.depth = fb.depth;
+    c.y = y;
+    c.x = x0;
+    c.x_end = x1;
+    return c;
+}
+
+/* Get the next run [*begin, *end) the draw may write, false at the end.
+ *
+ * In OCCLUSION_FRONT the run counts as covered by the draw from now on.
+ * Without a pass the whole range comes back as one run.
+ */
+bool
+span_next(SpanCursor *c, int32 *begin, int32 *end);
+
+#define SPAN_WHEEL_H
+#endif
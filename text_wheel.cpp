@@ -0,0 +1,166 @@
+#include "text_wheel.h"
+
+static uint64
+text_hash(const char *str, Font font);
+
+static bool
+has_room(TextCache *tc, uint64 area, uint64 strings, uint32 entries);
+
+static uint32
+least_recent_page(TextCache *tc);
+
+static void
+evict_page(TextCache *tc, uint32 page);
+
+TextCache *
+text_cache_create(AppMemory *mem, uint32 page_size, uint32 page_count, uint32 max_entries) {
+    TextCache *tc = (TextCache *)get_memory(mem, sizeof(TextCache));
+    memset(tc, 0, sizeof(*tc));
+    tc->atlas = atlas_create(mem, page_size, page_count);
+    tc->strings_size = (uint64)max_entries * TEXT_CACHE_STRING_BYTES;
+    tc->strings = (char *)get_memory(mem, tc->strings_size);
+    tc->entries = (TextCacheEntry *)get_memory(mem, max_entries * sizeof(TextCacheEntry));
+    tc->max_entries = max_entries;
+    return tc;
+}
+
+void
+text_cache_begin(TextCache *tc) {
+    tc->frame++;
+    if (!tc->wanted_entries)
+        return;
+    TextureAtlas *atlas = tc->atlas;
+    uint64 wanted_area = min(tc->wanted_area, (uint64)atlas->page_size * atlas->page_size * atlas->page_count);
+    uint64 wanted_strings = min(tc->wanted_strings, tc->strings_size);
+    uint32 wanted_entries = min(tc->wanted_entries, tc->max_entries);
+    // Free area does not mean a region fits, so at least one page goes.
+    if (tc->count)
+        evict_page(tc, least_recent_page(tc));
+    while (tc->count && !has_room(tc, wanted_area, wanted_strings, wanted_entries)) {
+        evict_page(tc, least_recent_page(tc));
+    }
+    tc->wanted_area = 0;
+    tc->wanted_strings = 0;
+    tc->wanted_entries = 0;
+}
+
+AtlasRegion
+text_cache_get(TextCache *tc, const char *str, Font font) {
+    uint64 hash = text_hash(str, font);
+    for (uint32 i = 0; i < tc->count; i++) {
+        TextCacheEntry *e = &tc->entries[i];
+        if (e->hash == hash && !strcmp(e->str, str)) {
+            e->last_used = tc->frame;
+            tc->hits++;
+            return e->region;
+        }
+    }
+    tc->misses++;
+    uint32 width, height;
+    text_size(str, font, &width, &height);
+    if (!width)
+        return {};
+    uint64 length = strlen(str) + 1;
+    // Evicting for a string that never fits would only empty the cache
+    // every frame, it gets drawn as plain text instead.
+    if (width > tc->atlas->page_size || height > tc->atlas->page_size || length > tc->strings_size)
+        return {};
+    AtlasRegion region = {};
+    if (tc->count < tc->max_entries && tc->strings_used + length <= tc->strings_size)
+        region = atlas_allocate(tc->atlas, width, height);
+    if (!region.width) {
+        tc->wanted_area += (uint64)width * height;
+        tc->wanted_strings += length;
+        tc->wanted_entries++;
+        return region;
+    }
+    TextCacheEntry *e = &tc->entries[tc->count++];
+    e->hash = hash;
+    e->str = tc->strings + tc->strings_used;
+    e->length = length;
+    e->region = region;
+    e->last_used = tc->frame;
+    memcpy((char *)e->str, str, length);
+    tc->strings_used += length;
+    // The region is clear and draw_string_to_texture only steps rows by the
+    // texture width, so the string is drawn straight into the page.
+    Texture target = atlas_page_texture(tc->atlas, region);
+    target.pixels += region.x + (uint64)region.y * target.width;
+    draw_string_to_texture(&target, str, font, {1, 1, 1, 1});
+    return region;
+}
+
+void
+render_push_text_cached(RenderCommands *rc, TextCache *tc, uint64 key, const char *str, Font font, v4 color, int32 x, int32 y) {
+    AtlasRegion region = text_cache_get(tc, str, font);
+    if (region.width) {
+        Blit blit = atlas_blit(region, BLIT_ALPHA);
+        blit.tint = premultiply_pixel(color_to_pixel(color));
+        render_push_blit(rc, key, atlas_page_texture(tc->atlas, region), x, y, blit);
+    }
+    else
+        render_push_text(rc, key, str, font, color, x, y);
+}
+
+// FNV-1a over the string, then the font's glyphs and cell size.
+static uint64
+text_hash(const char *str, Font font) {
+    uint64 h = 14695981039346656037ull;
+    for (; *str; str++) {
+        h = (h ^ (uint8)*str) * 1099511628211ull;
+    }
+    uint64 glyphs = font.glyphs ? (uint64)font.glyphs : (uint64)font.bitmap.pixels;
+    h = (h ^ glyphs) * 1099511628211ull;
+    return (h ^ ((uint64)font.cwidth << 32 | font.cheight)) * 1099511628211ull;
+}
+
+static bool
+has_room(TextCache *tc, uint64 area, uint64 strings, uint32 entries) {
+    TextureAtlas *atlas = tc->atlas;
+    uint64 free_area = 0;
+    for (uint32 i = 0; i < atlas->page_count; i++) {
+        free_area += (uint64)atlas->page_size * atlas->page_size - atlas->pages[i].used_area;
+    }
+    return free_area >= area && tc->strings_size - tc->strings_used >= strings && tc->max_entries - tc->count >= entries;
+}
+
+// The page whose most recently used string is the oldest. Every entry has a
+// region, so with any entry left some page is in use.
+static uint32
+least_recent_page(TextCache *tc) {
+    uint32 last_used[ATLAS_MAX_PAGES] = {};
+    for (uint32 i = 0; i < tc->count; i++) {
+        TextCacheEntry *e = &tc->entries[i];
+        last_used[e->region.page] = max(last_used[e->region.page], e->last_used);
+    }
+    TextureAtlas *atlas = tc->atlas;
+    uint32 oldest = atlas->page_count;
+    for (uint32 i = 0; i < atlas->page_count; i++) {
+        if (atlas->pages[i].region_count && (oldest == atlas->page_count || last_used[i] < last_used[oldest]))
+            oldest = i;
+    }
+    return oldest;
+}
+
+// Drop the strings on 'page' and slide the others' copies down over the gaps.
+static void
+evict_page(TextCache *tc, uint32 page) {
+    atlas_evict_page(tc->atlas, page);
+    uint32 count = 0;
+    uint64 offset = 0;
+    for (uint32 i = 0; i < tc->count; i++) {
+        TextCacheEntry e = tc->entries[i];
+        if (e.region.page == page) {
+            tc->evictions++;
+            continue;
+        }
+        if (e.str != tc->strings + offset) {
+            memmove(tc->strings + offset, e.str, e.length);
+            e.str = tc->strings + offset;
+        }
+        offset += e.length;
+        tc->entries[count++] = e;
+    }
+    tc->count = count;
+    tc->strings_used = offset;
+}
@@ -0,0 +1,70 @@
+#ifndef TEXT_WHEEL_H
+
+#include "render_wheel.h"
+#include "command_wheel.h"
+#include "memory_wheel.h"
+#include "atlas_wheel.h"
+
+/* Cache of rendered strings.
+ *
+ * Every string is laid out and drawn once in white into a region of a texture
+ * atlas, which is then composited with a single tinted blit in any color.
+ * Entries are keyed by a hash of the string and the font.
+ *
+ * Regions handed out stay valid until the next text_cache_begin, so misses
+ * never evict anything during a frame. A miss that does not fit returns an
+ * empty region and is remembered. The next text_cache_begin then evicts the
+ * least recently used atlas pages, with all strings on them, until the misses
+ * of the last frame could fit. Strings larger than a page or than the whole
+ * string pool are never cached nor remembered.
+ */
+#define TEXT_CACHE_STRING_BYTES 64 // Pooled per entry, on average
+
+struct TextCacheEntry {
+    uint64 hash;
+    const char *str; // Copy in the string pool
+    uint64 length; // Bytes of the copy
+    AtlasRegion region;
+    uint32 last_used; // Frame
+};
+
+struct TextCache {
+    TextureAtlas *atlas;
+    char *strings;
+    uint64 strings_size;
+    uint64 strings_used;
+    TextCacheEntry *entries; // In the order they were added
+    uint32 count;
+    uint32 max_entries;
+    uint32 frame;
+    // Misses that did not fit this frame
+    uint64 wanted_area;
+    uint64 wanted_strings;
+    uint32 wanted_entries;
+    // Statistics since the cache was created
+    uint32 hits;
+    uint32 misses;
+    uint32 evictions; // Strings
+};
+
+// Atlas of 'page_count' pages of 'page_size' squared pixels.
+TextCache *
+text_cache_create(AppMemory *mem, uint32 page_size, uint32 page_count, uint32 max_entries);
+
+// Start a frame. Makes room for the misses of the last frame, which
+// invalidates all regions handed out before.
+void
+text_cache_begin(TextCache *tc);
+
+// Region of the atlas with 'str' in white, without width if it is empty, the
+// cache is full or it is too large to be cached.
+AtlasRegion
+text_cache_get(TextCache *tc, const char *str, Font font);
+
+// Push 'str' as a blit out of the atlas, or as plain text if the cache has
+// no room for it this frame.
+void
+render_push_text_cached(RenderCommands *rc, TextCache *tc, uint64 key, const char *str, Font font, v4 color, int32 x, int32 y);
+
+#define TEXT_WHEEL_H
+#endif
@@ -0,0 +1,130 @@
+#include "tile_wheel.h"
+
+static void
+execute_tile(void *data, uint32 index);
+
+static void
+flush_tiles(TileRenderer *tr);
+
+static void
+allocate_tiles(TileRenderer *tr);
+
+TileRenderer *
+tile_renderer_create(AppMemory *mem, uint64 arena_size, JobSystem *jobs) {
+    TileRenderer *tr = (TileRenderer *)get_memory(mem, sizeof(TileRenderer));
+    memset(tr, 0, sizeof(*tr));
+    tr->arena = create_arena(mem, arena_size);
+    tr->jobs = jobs;
+    return tr;
+}
+
+void
+tile_renderer_begin(TileRenderer *tr, Framebuffer fb) {
+    fb.tiles = 0;
+    tr->fb = fb;
+    tr->tiles_x = (fb.width + TILE_SIZE - 1) / TILE_SIZE;
+    tr->tiles_y = (fb.height + TILE_SIZE - 1) / TILE_SIZE;
+    arena_reset(&tr->arena);
+    allocate_tiles(tr);
+}
+
+void *
+tile_push(Framebuffer draw, v2 min, v2 max, TileExecuteFn execute, uint64 size) {
+    TileRenderer *tr = draw.tiles;
+    Framebuffer fb = tr->fb;
+    // Written this way round so that NaN boxes are rejected as well.
+    if (!(max.x >= fb.clip_x0 && min.x < fb.clip_x1 && max.y >= fb.clip_y0 && min.y < fb.clip_y1))
+        return 0;
+    // Rasterizers may touch the pixel at the truncated maximum, so the box
+    // is grown by one pixel.
+    int32 x0 = (int32)max(min.x, (real32)fb.clip_x0);
+    int32 y0 = (int32)max(min.y, (real32)fb.clip_y0);
+    int32 x1 = (int32)min(max.x + 1, (real32)(fb.clip_x1 - 1));
+    int32 y1 = (int32)min(max.y + 1, (real32)(fb.clip_y1 - 1));
+    int32 tx0 = x0 / TILE_SIZE;
+    int32 ty0 = y0 / TILE_SIZE;
+    int32 tx1 = x1 / TILE_SIZE;
+    int32 ty1 = y1 / TILE_SIZE;
+
+    // Reserve the worst case up front so that no allocation below can fail.
+    uint64 needed = sizeof(TileCommand) + size + 16 + (tx1 - tx0 + 1) * (ty1 - ty0 + 1) * (sizeof(TileChunk) + 16);
+    if (needed > arena_remaining(&tr->arena)) {
+        flush_tiles(tr);
+        arena_reset(&tr->arena);
+        allocate_tiles(tr);
+        assert(needed <= arena_remaining(&tr->arena));
+    }
+
+    TileCommand *cmd = (TileCommand *)arena_push(&tr->arena, sizeof(TileCommand) + size);
+    cmd->execute = execute;
+    cmd->occlusion_pass = draw.occlusion_pass;
+    cmd->depth = draw.depth;
+    tr->command_count++;
+    for (int32 ty = ty0; ty <= ty1; ty++) {
+        for (int32 tx = tx0; tx <= tx1; tx++) {
+            Tile *tile = &tr->tiles[tx + ty * tr->tiles_x];
+            if (!tile->last || tile->last->count == TILE_CHUNK_SIZE) {
+                TileChunk *chunk = (TileChunk *)arena_push(&tr->arena, sizeof(TileChunk));
+                chunk->next = 0;
+                chunk->count = 0;
+                if (tile->last)
+                    tile->last->next = chunk;
+                else
+                    tile->first = chunk;
+                tile->last = chunk;
+            }
+            tile->last->commands[tile->last->count++] = cmd;
+        }
+    }
+    return cmd + 1;
+}
+
+void
+tile_renderer_end(TileRenderer *tr) {
+    flush_tiles(tr);
+    arena_reset(&tr->arena);
+    tr->tiles = 0;
+}
+
+static void
+allocate_tiles(TileRenderer *tr) {
+    uint64 size = tr->tiles_x * tr->tiles_y * sizeof(Tile);
+    tr->tiles = (Tile *)arena_push(&tr->arena, size);
+    assert(tr->tiles);
+    memset(tr->tiles, 0, size);
+    tr->command_count = 0;
+}
+
+static void
+flush_tiles(TileRenderer *tr) {
+    if (!tr->command_count)
+        return;
+    JobCounter counter = {};
+    uint32 count = tr->tiles_x * tr->tiles_y;
+    for (uint32 i = 0; i < count; i++) {
+        if (tr->tiles[i].first)
+            job_submit(tr->jobs, execute_tile, tr, i, &counter);
+    }
+    job_wait(tr->jobs, &counter);
+}
+
+static void
+execute_tile(void *data, uint32 index) {
+    TileRenderer *tr = (TileRenderer *)data;
+    Tile *tile = &tr->tiles[index];
+    int32 tx = index % tr->tiles_x;
+    int32 ty = index / tr->tiles_x;
+    Framebuffer fb = tr->fb;
+    fb.clip_x0 = max(fb.clip_x0, tx * TILE_SIZE);
+    fb.clip_y0 = max(fb.clip_y0, ty * TILE_SIZE);
+    fb.clip_x1 = min(fb.clip_x1, (tx + 1) * TILE_SIZE);
+    fb.clip_y1 = min(fb.clip_y1, (ty + 1) * TILE_SIZE);
+    for (TileChunk *chunk = tile->first; chunk; chunk = chunk->next) {
+        for (uint32 i = 0; i < chunk->count; i++) {
+            TileCommand *cmd = chunk->commands[i];
+            fb.occlusion_pass = cmd->occlusion_pass;
+            fb.depth = cmd->depth;
+            cmd->execute(fb, cmd + 1);
+        }
+    }
+}
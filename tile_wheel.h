@@ -0,0 +1,69 @@
+#ifndef TILE_WHEEL_H
+
+#include "wheel.h"
+#include "job_wheel.h"
+#include "memory_wheel.h"
+#include "math_wheel.h"
+
+#define TILE_SIZE 64
+#define TILE_CHUNK_SIZE 32
+
+/* Binning renderer.
+ *
+ * Draw calls are recorded once in screen space and appended to every
+ * TILE_SIZE x TILE_SIZE tile their bounding box touches. When the frame ends
+ * every tile with commands becomes one job. A tile is owned by a single job
+ * and runs its commands in submission order, so the image is the same as if
+ * everything had been drawn immediately.
+ */
+typedef void (*TileExecuteFn)(Framebuffer fb, const void *data);
+
+struct TileCommand {
+    TileExecuteFn execute;
+    // Occlusion state of the draw call, restored when the command runs.
+    OcclusionPass occlusion_pass;
+    uint32 depth;
+    // The payload follows the header.
+};
+
+struct TileChunk {
+    TileChunk *next;
+    uint32 count;
+    TileCommand *commands[TILE_CHUNK_SIZE];
+};
+
+struct Tile {
+    TileChunk *first;
+    TileChunk *last;
+};
+
+struct TileRenderer {
+    MemoryArena arena;
+    Framebuffer fb;
+    Tile *tiles;
+    int32 tiles_x, tiles_y;
+    uint32 command_count;
+    JobSystem *jobs;
+};
+
+TileRenderer *
+tile_renderer_create(AppMemory *mem, uint64 arena_size, JobSystem *jobs);
+
+void
+tile_renderer_begin(TileRenderer *tr, Framebuffer fb);
+
+/* Record a command of the draw call 'fb' belongs to, covering the
+ * screen-space box [min, max], in fb.tiles.
+ *
+ * Returns storage for 'size' bytes of payload that gets passed to 'execute'
+ * for every tile, or 0 if the box lies outside the clip rectangle and nothing
+ * needs to be drawn.
+ */
+void *
+tile_push(Framebuffer draw, v2 min, v2 max, TileExecuteFn execute, uint64 size);
+
+void
+tile_renderer_end(TileRenderer *tr);
+
+#define TILE_WHEEL_H
+#endif
@@ -1,6 +1,7 @@
 #ifndef TYPES_WHEEL_H
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #define int8 char
 #define int16 short
@@ -8,67 +8,79 @@
 #include "wheel.h"
 #include "files_wheel.h"
 #include "scene_wheel.h"
+#include "layer_wheel.h"
+#include "text_wheel.h"
+#include "hud_wheel.h"
+#include "bench_wheel.h"
 
 struct AppState {
     Scene *current_scene;
-    Texture testimg;
-    Font test_font;
-    real64 app_time;
+    JobSystem *jobs;
+    TileRenderer *tiles;
+    RenderCommands *commands;
+    CachedLayer *grid_layer;
+    SpanBuffer *occlusion; // Allocated when culling is first turned on
+    bool occlusion_culling;
+    bool antialias; // Off by default, edges cost about 1.5x the fill
+    Font font;
+    TextCache *text;
+    PerfHud *hud;
     int32 mouse_x;
     int32 mouse_y;
-    uint32 frame_count;
-    uint32 fps;
 };
 
-static Font
-load_bitmap_font(const char* filename, AppMemory *mem, uint32 cwidth, uint32 cheight, uint32 ascii_offset) {
-    Font font = {};
-
-    font.bitmap = load_bmp_file(filename, mem);
-    font.cwidth = cwidth;
-    font.cheight = cheight;
-    font.ascii_offset = ascii_offset;
+struct PhysicsFrame {
+    Scene *scene;
+    JobSystem *jobs;
+    PerfHud *hud;
+    real64 frame_time;
+};
 
-    return font;
-}
+static void
+physics_job(void *data, uint32 index) {
+    PhysicsFrame *frame = (PhysicsFrame *)data;
+    Scene *scene = frame->scene;
+    real64 time_left = frame->frame_time;
+    hud_begin(frame->hud, HUD_PHYSICS);
+    while (time_left > 0.0) {
+        real64 d_t = min(frame->frame_time, 1.0d / SIM_RATE);
 
-static Texture
-create_string_texture(const char* str, AppMemory *mem, Font f, v4 color) {
-    uint32 width = 0;
-    uint32 max_width = 0;
-    uint32 height = 1;
-    const char *str_orig = str;
-    while (*str) {
-        if (*str == '\n') {
-            width = 0;
-            height++;
-        }
-        else {
-            width++;
-            max_width = max(width, max_width);
+        if (!scene->paused) {
+            Body *player_body = scene->entities[scene->player_index].bodies[0];
+            player_body->p_ang += d_t * 100 * PI / 180;
+            physics_integrate(&scene->bodies, d_t, frame->jobs);
+            scene->scene_time += d_t;
         }
-        str++;
+        time_left -= d_t;
     }
-    width *= f.cwidth;
-    height *= f.cheight;
-    Texture texture = {};
-    texture.pixels = (uint32 *)get_memory(mem, sizeof(uint32) * width * height);
-    texture.width = width;
-    texture.height = height;
-    draw_string_to_texture(&texture, str_orig, f, color);
-    return texture;
+    hud_end(frame->hud, HUD_PHYSICS);
 }
 
+static void
+draw_grid_layer(RenderCommands *rc, const Camera &camera, void *data) {
+    draw_grid((Scene *)data, camera, rc);
+}
 
 AppHandle
 initialize_app() {
     // TODO: This is completely arbitrary!
-    static constexpr uint32 mem_size = megabytes(1);
+    static constexpr uint32 mem_size = megabytes(16);
     AppMemory *mem = initialize_memory(mem_size);
 
     AppState *as = (AppState *)get_memory(mem, sizeof(AppState));
+    as->jobs = job_system_create(mem);
+    as->hud = hud_create(mem);
+    mem->tag = MEMORY_SCENE;
     Scene *scene = initialize_scene(mem);
     as->current_scene = scene;
+    mem->tag = MEMORY_RENDER;
+    as->tiles = tile_renderer_create(mem, megabytes(4), as->jobs);
+    as->commands = render_commands_create(mem, megabytes(1));
+    as->grid_layer = layer_create(mem, WIN_WIDTH, WIN_HEIGHT, draw_grid_layer, scene);
+    mem->tag = MEMORY_TEXT;
+    as->font = load_glyph_font("monogram-bitmap.json", mem, 6, 12);
+    as->text = text_cache_create(mem, 256, 2, 128);
+    mem->tag = MEMORY_SCENE;
 
     uint32 player = scene_create_entitiy(scene);
     v2 poly_def[4] = {
@@ -86,6 +98,8 @@ initialize_app() {
     scene_link_body_to_entity(scene, body, player);
 
     scene->player_index = player;
+    scene_build_level(scene, mem);
+    mem->tag = MEMORY_OTHER;
 
     return (AppHandle)mem;
 }
@@ -97,55 +111,50 @@ app_update_and_render(real64 frame_time, AppHandle app, Framebuffer fb) {
     Scene *scene = as->current_scene;
 
     // PHYSICS
-    real64 time_left = frame_time;
-    while (time_left > 0.0) {
-        real64 d_t = min(frame_time, 1.0d / SIM_RATE);
-
-        if (!scene->paused) {
-            Body *player_body = scene->entities[scene->player_index].bodies[0];
-            player_body->p_ang += d_t * 100 * PI / 180;
-            scene->scene_time += d_t;
-        }
-        time_left -= d_t;
-    }
+    // The grid does not depend on bodies, so it gets recorded while the
+    // physics job runs.
+    PhysicsFrame physics = {scene, as->jobs, as->hud, frame_time};
+    JobCounter physics_done = {};
+    job_submit(as->jobs, physics_job, &physics, 0, &physics_done);
 
     // RENDER
-    clear_framebuffer(fb, {0});
-
-    draw_grid(scene, fb);
-
-    scene_draw_bodies(scene, fb, mem);
-
-    as->app_time += frame_time;
-    as->frame_count++;
-
-    if (as->app_time > 1.0f) {
-        as->fps = round((as->frame_count / as->app_time));
-        as->frame_count = 0;
-        as->app_time = 0;
-        char str[64];
-        sprintf(str, "FPS: %2d", as->fps);
-        //printf("%s\n", str);
-
-        uint64 mem_unit = 1;
-        uint64 mem_multiple = mem->used_size;
-        const char *desc[4] = {
-            "B",
-            "KB",
-            "MB",
-            "GB"
-        };
-        uint32 i = 0;
-        while (mem_multiple / 1024) {
-            mem_unit *= 1024;
-            mem_multiple /= mem_unit;
-            i++;
-        }
-        real32 mem_decimal = (real32) mem->used_size / mem_unit;
-        real32 frag_decimal = (real32) mem->fragmented / mem_unit;
-        printf("Total memory used: %4.2f %s\n", mem_decimal, desc[min(i, 3)]);
-        printf("Fragmented memory: %4.2f %s\n", frag_decimal, desc[min(i, 3)]);
-    }
+    RenderCommands *rc = as->commands;
+    render_commands_begin(rc, fb);
+    text_cache_begin(as->text);
+
+    // The grid layer is opaque and covers the whole screen, so there is
+    // nothing to clear.
+    hud_begin(as->hud, HUD_GRID);
+    Texture grid = layer_update(as->grid_layer, scene->camera);
+    hud_end(as->hud, HUD_GRID);
+    render_push_texture(rc, render_key(LAYER_BACKGROUND, 0, 0), grid, 0, 0, false);
+
+    job_wait(as->jobs, &physics_done);
+
+    hud_begin(as->hud, HUD_BODIES);
+    scene_draw_level(scene, rc);
+    scene_draw_bodies(scene, rc, mem);
+    hud_end(as->hud, HUD_BODIES);
+
+    render_push_hud(rc, as->text, as->hud, as->font, 4, 4);
+
+    fb.tiles = as->tiles;
+    fb.antialias = as->antialias;
+    // Culling only pays off once pixels are expensive to shade. The flat
+    // shapes of the scene cost less to overdraw than to cull.
+    fb.occlusion = as->occlusion_culling ? as->occlusion : 0;
+    hud_begin(as->hud, HUD_RENDER);
+    tile_renderer_begin(as->tiles, fb);
+    render_commands_execute(rc, fb);
+    hud_count(as->hud, HUD_TILE_COMMANDS, as->tiles->command_count);
+    tile_renderer_end(as->tiles);
+    hud_end(as->hud, HUD_RENDER);
+
+    hud_count(as->hud, HUD_DRAW_CALLS, rc->count);
+    hud_count(as->hud, HUD_CULLED, rc->culled);
+    hud_count(as->hud, HUD_DROPPED, rc->dropped);
+    hud_count(as->hud, HUD_BODY_COUNT, scene->bodies.count);
+    hud_end_frame(as->hud, frame_time, mem, FRAME_RATE / 2);
 
     /*
     if (frame_time > 1.0f / ((double)FRAME_RATE) + 0.006f) {
@@ -154,6 +163,28 @@ app_update_and_render(real64 frame_time, AppHandle app, Framebuffer fb) {
     */
 }
 
+uint32
+app_run_benchmark(const char *golden_dir, bool record) {
+    static constexpr uint32 frames = 20;
+    AppMemory *mem = initialize_memory(megabytes(32));
+    JobSystem *jobs = job_system_create(mem);
+    Font font = load_glyph_font("monogram-bitmap.json", mem, 6, 12);
+    BenchResult results[BENCH_CASE_COUNT];
+    uint32 failed = bench_run(mem, jobs, font, WIN_WIDTH, WIN_HEIGHT, frames, golden_dir, record, results);
+    for (uint32 i = 0; i < BENCH_CASE_COUNT; i++) {
+        BenchResult *r = &results[i];
+        printf("%-16s %7.3f ms %7.3f ms tiled %8.1f Mpixels/s %9.1f K%s/s  ", r->name, 1000 * r->seconds,
+               1000 * r->tiled_seconds, r->pixels / r->seconds * 1e-6, r->primitives / r->seconds * 1e-3, r->unit);
+        if (!record && !r->compared)
+            printf("FAILED, no golden image\n");
+        else if (record)
+            printf("%s, tiled %u pixels off\n", r->passed ? "recorded" : "FAILED", r->tiled_mismatches);
+        else
+            printf("%s, %u pixels off, tiled %u\n", r->passed ? "ok" : "FAILED", r->mismatches, r->tiled_mismatches);
+    }
+    return failed;
+}
+
 void
 key_callback(KeyBoardInput key, InputType t, AppHandle app) {
     AppState *as = (AppState *)(((AppMemory *)app)->data);
@@ -173,6 +204,29 @@ key_callback(KeyBoardInput key, InputType t, AppHandle app) {
         case KEY_D:
             dir += mag * v2{ 1, 0};
             break;
+        case KEY_H:
+            if (t == IT_PRESSED)
+                hud_toggle(as->hud);
+            break;
+        case KEY_E:
+            if (t == IT_PRESSED) {
+                as->antialias = !as->antialias;
+                printf("Anti-aliasing %s.\n", as->antialias ? "on" : "off");
+            }
+            break;
+        case KEY_O:
+            if (t == IT_PRESSED) {
+                if (!as->occlusion) {
+                    AppMemory *mem = (AppMemory *)app;
+                    MemoryTag tag = mem->tag;
+                    mem->tag = MEMORY_RENDER;
+                    as->occlusion = span_buffer_create(mem, WIN_WIDTH, WIN_HEIGHT);
+                    mem->tag = tag;
+                }
+                as->occlusion_culling = !as->occlusion_culling;
+                printf("Occlusion culling %s.\n", as->occlusion_culling ? "on" : "off");
+            }
+            break;
         case KEY_SPACE:
             if (t == IT_PRESSED) {
                 scene->paused = !scene->paused;
@@ -75,9 +75,31 @@ struct GameInput {
     bool up, down, left, right, pause, fwd;
 };
 
+struct TileRenderer;
+struct SpanBuffer;
+
+// How a draw call takes part in occlusion culling, see span_wheel.h.
+enum OcclusionPass {
+    OCCLUSION_NONE,
+    OCCLUSION_FRONT,
+    OCCLUSION_BACK
+};
+
 struct Framebuffer {
     unsigned int *data;
     int width, height, bytes_per_pixel;
+    // Drawing only touches [clip_x0, clip_x1) x [clip_y0, clip_y1).
+    int clip_x0, clip_y0, clip_x1, clip_y1;
+    // If set, draw calls are binned and rasterized when the frame ends.
+    TileRenderer *tiles;
+    // If set, shapes and single triangles get anti-aliased edges.
+    bool antialias;
+    // If set, opaque shapes are drawn front to back before anything else and
+    // what lies behind them is not drawn at all.
+    SpanBuffer *occlusion;
+    // Pass and position in the frame of the draw call that is running.
+    OcclusionPass occlusion_pass;
+    uint32 depth;
 };
 
 AppHandle
@@ -95,4 +117,10 @@ mouse_button_callback(MouseButton, InputType t, int x, int y, AppHandle game);
 void
 mouse_move_callback(int x, int y, uint32 mask, AppHandle game);
 
+// Run the rasterizer benchmark without a window and print the results, see
+// bench_wheel.h. Returns the number of scenes that did not match their
+// golden image in 'golden_dir', or could not be recorded there.
+uint32
+app_run_benchmark(const char *golden_dir, bool record);
+
 #endif
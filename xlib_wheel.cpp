@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -16,6 +17,7 @@
 #endif
 
 #include "wheel.h"
+#include "present_wheel.h"
 
 static KeyBoardInput
 get_key(int xkc, Display* disp, unsigned int state) {
@@ -181,6 +183,22 @@ ximage_create(Display *display, XVisualInfo *visinfo, Framebuffer *fb, uint32 wi
 
 int main(int argc, char **argv) {
 
+    // "bench [dir]" renders the benchmark scenes and compares them against
+    // the golden images in dir, "record [dir]" replaces those. The checked
+    // in ones are in golden/.
+    if (argc > 1 && (!strcmp(argv[1], "bench") || !strcmp(argv[1], "record"))) {
+        bool record = !strcmp(argv[1], "record");
+        return app_run_benchmark(argc > 2 ? argv[2] : "golden", record) ? 1 : 0;
+    }
+
+    // Frames can go out as 16 or 8 bits per pixel, e.g. to thin clients on
+    // slow links, see present_wheel.h.
+    PixelFormat format = PIXEL_XRGB8888;
+    if (argc > 1 && !strcmp(argv[1], "rgb565"))
+        format = PIXEL_RGB565;
+    else if (argc > 1 && !strcmp(argv[1], "indexed8"))
+        format = PIXEL_INDEXED8;
+
     Display *display = XOpenDisplay(0);
 
     if (!display) {
@@ -199,14 +217,47 @@ int main(int argc, char **argv) {
     int defaultScreen = DefaultScreen(display);
 
     int screenBitDepth = 24;
+    int visualClass = TrueColor;
+    if (format == PIXEL_RGB565) {
+        screenBitDepth = 16;
+    }
+    else if (format == PIXEL_INDEXED8) {
+        screenBitDepth = 8;
+        visualClass = PseudoColor;
+    }
     XVisualInfo visinfo = {};
-    if(!XMatchVisualInfo(display, defaultScreen, screenBitDepth, TrueColor, &visinfo)) {
+    if (format != PIXEL_XRGB8888 &&
+        (!XMatchVisualInfo(display, defaultScreen, screenBitDepth, visualClass, &visinfo) ||
+         (format == PIXEL_RGB565 && visinfo.red_mask != 0xF800))) {
+        printf("No %d-bit visual, using 24 bits.\n", screenBitDepth);
+        format = PIXEL_XRGB8888;
+        screenBitDepth = 24;
+        visualClass = TrueColor;
+    }
+    if(!XMatchVisualInfo(display, defaultScreen, screenBitDepth, visualClass, &visinfo)) {
         printf("No matching visual info.\n");
         exit(1);
     }
     XSetWindowAttributes windowAttr;
     windowAttr.background_pixel = 0;
-    windowAttr.colormap = XCreateColormap(display, root, visinfo.visual, AllocNone);
+    Palette palette = {};
+    if (format == PIXEL_INDEXED8) {
+        windowAttr.colormap = XCreateColormap(display, root, visinfo.visual, AllocAll);
+        palette_create_default(&palette);
+        XColor colors[256];
+        for (uint32 i = 0; i < palette.count; i++) {
+            uint32 c = palette.colors[i];
+            colors[i].pixel = i;
+            colors[i].red = ((c >> 16) & 0xFF) * 257;
+            colors[i].green = ((c >> 8) & 0xFF) * 257;
+            colors[i].blue = (c & 0xFF) * 257;
+            colors[i].flags = DoRed | DoGreen | DoBlue;
+        }
+        XStoreColors(display, windowAttr.colormap, colors, palette.count);
+    }
+    else {
+        windowAttr.colormap = XCreateColormap(display, root, visinfo.visual, AllocNone);
+    }
     windowAttr.event_mask = StructureNotifyMask;
     unsigned long attributeMask = CWBackPixel | CWColormap | CWEventMask;
 
@@ -236,6 +287,8 @@ int main(int argc, char **argv) {
     fb.width = WIN_WIDTH;
     fb.height = WIN_HEIGHT;
     fb.bytes_per_pixel = 4;
+    fb.clip_x1 = WIN_WIDTH;
+    fb.clip_y1 = WIN_HEIGHT;
 
 
 #ifdef SHARED_MEM_SUPORT
@@ -250,6 +303,13 @@ int main(int argc, char **argv) {
 
     fb.data = (uint32 *)ximage_a->data;
 
+    // Converted frames are drawn into a buffer of their own and written to
+    // the image that is not on its way to the server.
+    XImage *convert_img = ximage_a;
+    if (format != PIXEL_XRGB8888) {
+        fb.data = (uint32 *)malloc(fb.width * fb.height * fb.bytes_per_pixel);
+    }
+
     GC defaultGC = DefaultGC(display, defaultScreen);
 
     // Graceful window close
@@ -324,7 +384,11 @@ int main(int argc, char **argv) {
 
         XImage *read_img = ximage_a;
 
-        if (fb.data == (uint32 *)ximage_a->data) {
+        if (format != PIXEL_XRGB8888) {
+            read_img = convert_img;
+            present_convert(fb, format, &palette, read_img->data, read_img->bytes_per_line);
+            convert_img = convert_img == ximage_a ? ximage_b : ximage_a;
+        } else if (fb.data == (uint32 *)ximage_a->data) {
             fb.data = (uint32 *)ximage_b->data;
             read_img = ximage_a;
         } else {